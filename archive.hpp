@@ -0,0 +1,303 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef ARCHIVE_HPP
+#define ARCHIVE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+#include "brainwire.hpp"
+#include "neuralink.hpp"
+#include "threadpool.hpp"
+
+/*
+ * Cross-channel prediction of the archive mode
+ *
+ * Electrodes that pick up the same source move together. In archive mode the encoder reads the
+ * first PREDICTION_FIT_FRAMES frames of the recording, and fits for every channel a linear
+ * prediction from up to MAX_PREDICTION_SOURCES of the PREDICTION_WINDOW channels numbered
+ * right below it, in the same frame. The channel is then coded as the residual
+ *
+ *   y[c] = (x[c] - ((sum of coefficient * (x[s] - 512)) + 128) >> 8) mod 1024
+ *
+ * where x are the 10 bit symbols of the frame and the sum runs over the predictions of target
+ * c. The residual keeps the part of the channel that the sources do not explain, around the
+ * level of the channel itself, so the model still follows it as a signal of its own. The
+ * predictions are stored in the stream header. Every channel keeps its own substream of the
+ * multi-channel container, so the decoder still decodes the channels concurrently, and undoes
+ * the prediction frame by frame in channel order afterwards.
+ */
+
+// Largest number of source channels predicting a channel
+static constexpr size_t MAX_PREDICTION_SOURCES = 2;
+
+// Fixed point scale of the prediction coefficients
+static constexpr int PREDICTION_SHIFT = 8;
+
+// Symbol level of zero signal, the sources are predicted relative to it
+static constexpr int32_t PREDICTION_ZERO = 512;
+
+// Smallest relative size reduction for which the fit keeps another source channel
+static constexpr double PREDICTION_MIN_GAIN = 0.002;
+
+// Number of channels right below a channel that the fit tries as its sources; neighbouring
+// channel numbers are usually neighbouring electrodes
+static constexpr size_t PREDICTION_WINDOW = 8;
+
+// Number of frames at the start of the recording that the fit uses, about 0.2 s of data
+static constexpr size_t PREDICTION_FIT_FRAMES = 1 << 12;
+
+// Largest number of channels, the prediction terms store channel numbers in 16 bits
+static constexpr size_t MAX_PREDICTION_CHANNELS = 1 << 16;
+
+
+/**
+ * @brief Applies or undoes the cross-channel prediction of interleaved 10 bit symbols.
+ *
+ * The predictor keeps the position in the frame, so a recording can be transformed in chunks
+ * of any size.
+ */
+class ChannelPredictor {
+public:
+    /**
+     * @param channels The number of interleaved channels.
+     * @param predictions The prediction terms, see BrainwirePrediction.
+     * @throws std::runtime_error if a term refers to a missing channel or a source that is not
+     *         lower than its target.
+     */
+    ChannelPredictor(size_t channels, const std::vector<BrainwirePrediction> &predictions)
+        : sources(channels), current(channels, PREDICTION_ZERO) {
+        for (const BrainwirePrediction &prediction : predictions) {
+            if (prediction.target >= channels || prediction.source >= prediction.target) {
+                throw std::runtime_error("Invalid cross-channel prediction");
+            }
+            sources[prediction.target].push_back(prediction);
+        }
+    }
+
+    /**
+     * @brief Replaces the symbols by their prediction residuals.
+     */
+    void forward(SymbolType *symbols, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            current[position] = symbols[i];
+            symbols[i] = static_cast<SymbolType>((symbols[i] - predict(position)) & 0x3FF);
+            advance();
+        }
+    }
+
+    /**
+     * @brief Replaces prediction residuals by the original symbols.
+     */
+    void inverse(SymbolType *symbols, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            symbols[i] = static_cast<SymbolType>((symbols[i] + predict(position)) & 0x3FF);
+            current[position] = symbols[i];
+            advance();
+        }
+    }
+
+private:
+    int32_t predict(size_t channel) const {
+        int32_t sum = 0;
+        for (const BrainwirePrediction &prediction : sources[channel]) {
+            sum += prediction.coefficient * (current[prediction.source] - PREDICTION_ZERO);
+        }
+        return (sum + (1 << (PREDICTION_SHIFT - 1))) >> PREDICTION_SHIFT;
+    }
+
+    void advance() {
+        if (++position == current.size()) {
+            position = 0;
+        }
+    }
+
+    std::vector<std::vector<BrainwirePrediction>> sources; ///< the terms of every target channel
+    std::vector<int32_t> current;  ///< symbols of the frame being transformed
+    size_t position = 0;           ///< channel of the next symbol
+};
+
+
+/**
+ * @brief The prediction residuals of a channel for a set of prediction terms.
+ *
+ * Computes the same residuals as ChannelPredictor::forward on the deinterleaved channels.
+ */
+inline std::vector<SymbolType> prediction_residuals(const std::vector<std::vector<SymbolType>> &channels, size_t target,
+                                                    const std::vector<BrainwirePrediction> &predictions) {
+    const std::vector<SymbolType> &x = channels[target];
+    std::vector<SymbolType> residuals(x.size());
+    for (size_t t = 0; t < x.size(); ++t) {
+        int32_t sum = 0;
+        for (const BrainwirePrediction &prediction : predictions) {
+            sum += prediction.coefficient * (static_cast<int32_t>(channels[prediction.source][t]) - PREDICTION_ZERO);
+        }
+        const int32_t predicted = (sum + (1 << (PREDICTION_SHIFT - 1))) >> PREDICTION_SHIFT;
+        residuals[t] = static_cast<SymbolType>((x[t] - predicted) & 0x3FF);
+    }
+    return residuals;
+}
+
+
+/**
+ * @brief Least squares prediction terms of a channel from source channels.
+ *
+ * Solves the normal equations of the deviations from the channel means of up to
+ * MAX_PREDICTION_SOURCES sources, so the residual keeps the mean of the target, and rounds the
+ * coefficients to the fixed point scale. Returns no terms if the system is singular.
+ */
+inline std::vector<BrainwirePrediction> fit_prediction(const std::vector<std::vector<SymbolType>> &channels, size_t target,
+                                                       const std::vector<size_t> &sources) {
+    const size_t n = sources.size();
+    double a[MAX_PREDICTION_SOURCES][MAX_PREDICTION_SOURCES] = {};
+    double b[MAX_PREDICTION_SOURCES] = {};
+    const std::vector<SymbolType> &x = channels[target];
+    if (x.empty()) {
+        return {};
+    }
+    double mean[MAX_PREDICTION_SOURCES + 1] = {};
+    for (size_t t = 0; t < x.size(); ++t) {
+        for (size_t j = 0; j < n; ++j) {
+            mean[j] += channels[sources[j]][t];
+        }
+        mean[n] += x[t];
+    }
+    for (size_t j = 0; j <= n; ++j) {
+        mean[j] /= x.size();
+    }
+
+    for (size_t t = 0; t < x.size(); ++t) {
+        double d[MAX_PREDICTION_SOURCES];
+        for (size_t j = 0; j < n; ++j) {
+            d[j] = channels[sources[j]][t] - mean[j];
+        }
+        const double y = x[t] - mean[n];
+        for (size_t j = 0; j < n; ++j) {
+            b[j] += d[j] * y;
+            for (size_t k = 0; k < n; ++k) {
+                a[j][k] += d[j] * d[k];
+            }
+        }
+    }
+
+    double w[MAX_PREDICTION_SOURCES];
+    if (n == 1) {
+        if (a[0][0] <= 0) {
+            return {};
+        }
+        w[0] = b[0] / a[0][0];
+    } else {
+        const double det = a[0][0] * a[1][1] - a[0][1] * a[1][0];
+        if (std::fabs(det) <= 1e-9 * a[0][0] * a[1][1]) {
+            return {};
+        }
+        w[0] = (b[0] * a[1][1] - b[1] * a[0][1]) / det;
+        w[1] = (b[1] * a[0][0] - b[0] * a[1][0]) / det;
+    }
+
+    std::vector<BrainwirePrediction> predictions;
+    for (size_t j = 0; j < n; ++j) {
+        const double scaled = std::round(w[j] * (1 << PREDICTION_SHIFT));
+        BrainwirePrediction prediction;
+        prediction.target = static_cast<uint16_t>(target);
+        prediction.source = static_cast<uint16_t>(sources[j]);
+        prediction.coefficient = static_cast<int16_t>(std::max(-32768.0, std::min(32767.0, scaled)));
+        if (prediction.coefficient != 0) {
+            predictions.push_back(prediction);
+        }
+    }
+    return predictions;
+}
+
+
+/**
+ * @brief Fits the cross-channel predictions of an interleaved recording.
+ *
+ * For every channel the fit greedily adds the source channel among the PREDICTION_WINDOW
+ * channels below it whose least squares prediction most reduces the estimated coded size of
+ * the residuals under the model, as long as it gains at least PREDICTION_MIN_GAIN. Channels
+ * are fitted concurrently. Every candidate costs an estimate over all frames, so callers pass
+ * a bounded part of the recording, see PREDICTION_FIT_FRAMES.
+ *
+ * @param symbols The interleaved 10 bit symbols of the recording.
+ * @param count The number of symbols, a multiple of the number of channels.
+ * @param channels The number of interleaved channels, at most MAX_PREDICTION_CHANNELS.
+ * @param pool The threads fitting the channels.
+ * @param model The model used for the size estimates.
+ * @return The prediction terms, ordered by target channel.
+ */
+template <typename M>
+std::vector<BrainwirePrediction> fit_channel_predictions(const SymbolType *symbols, size_t count, size_t channels,
+                                                         ThreadPool &pool, const M &model = M()) {
+    if (channels == 0 || channels > MAX_PREDICTION_CHANNELS) {
+        throw std::runtime_error("Unsupported number of channels for cross-channel prediction");
+    }
+    std::vector<std::vector<SymbolType>> x(channels);
+    for (size_t c = 0; c < channels; ++c) {
+        x[c].reserve(count / channels);
+    }
+    for (size_t i = 0; i + channels <= count; i += channels) {
+        for (size_t c = 0; c < channels; ++c) {
+            x[c].push_back(symbols[i + c]);
+        }
+    }
+
+    std::vector<std::vector<BrainwirePrediction>> fits(channels);
+    pool.parallel_for(channels, [&](size_t target) {
+        std::vector<size_t> chosen;
+        double best_bits = model_entropy_bits(model, x[target].data(), x[target].size());
+        while (chosen.size() < std::min(MAX_PREDICTION_SOURCES, target)) {
+            std::vector<size_t> best_sources;
+            std::vector<BrainwirePrediction> best_fit;
+            double bits_limit = best_bits * (1 - PREDICTION_MIN_GAIN);
+            for (size_t source = target - std::min(target, PREDICTION_WINDOW); source < target; ++source) {
+                if (std::find(chosen.begin(), chosen.end(), source) != chosen.end()) {
+                    continue;
+                }
+                std::vector<size_t> candidate = chosen;
+                candidate.push_back(source);
+                std::vector<BrainwirePrediction> fit = fit_prediction(x, target, candidate);
+                if (fit.size() != candidate.size()) {
+                    continue;
+                }
+                std::vector<SymbolType> residuals = prediction_residuals(x, target, fit);
+                double bits = model_entropy_bits(model, residuals.data(), residuals.size());
+                if (bits < bits_limit) {
+                    bits_limit = bits;
+                    best_sources = candidate;
+                    best_fit = fit;
+                }
+            }
+            if (best_sources.empty()) {
+                break;
+            }
+            chosen = best_sources;
+            fits[target] = best_fit;
+            best_bits = bits_limit;
+        }
+    });
+
+    std::vector<BrainwirePrediction> predictions;
+    for (const std::vector<BrainwirePrediction> &fit : fits) {
+        predictions.insert(predictions.end(), fit.begin(), fit.end());
+    }
+    return predictions;
+}
+
+#endif
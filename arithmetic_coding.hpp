@@ -21,18 +21,58 @@
 #include <algorithm>
 #include <cassert>
 #include "bitstream.hpp"
+#include "checkpoint.hpp"
 
 
+/**
+ * @brief Narrows the coder range [low, high] to the [symbol_low, symbol_high) frequency range.
+ *
+ * @tparam T The model type, T::MAX_FREQUENCY is the total of the frequency table.
+ */
+template <typename T>
 void forward_range(uint32_t &low, uint32_t &high, uint32_t symbol_low, uint32_t symbol_high) {
-    uint32_t range = high - low + 1;
-    high = low + range * symbol_high / 0x7FFF - 1;
-    low = low + range * symbol_low / 0x7FFF;
+    uint64_t range = high - low + 1;
+    high = low + static_cast<uint32_t>(range * symbol_high / T::MAX_FREQUENCY) - 1;
+    low = low + static_cast<uint32_t>(range * symbol_low / T::MAX_FREQUENCY);
 }
 
 
+/**
+ * @brief Maps the code value back to the cumulative frequency of the symbol it lies in.
+ *
+ * @tparam T The model type, T::MAX_FREQUENCY is the total of the frequency table.
+ */
+template <typename T>
 uint32_t backward_value(uint32_t value, uint32_t low, uint32_t high) {
+    // (value - low + 1) <= 2^CODE_BITS and MAX_FREQUENCY <= Int25, so the result fits 32 bits.
+    // For a 2^15 total the product can wrap to exactly 2^32, which the - 1 undoes.
     uint32_t range = high - low + 1;
-    return ((value - low + 1) * 0x7FFF - 1) / range;
+    return ((value - low + 1) * T::MAX_FREQUENCY - 1) / range;
+}
+
+
+/**
+ * @brief Counts the number of leading zero bits of a non-zero 32 bit value.
+ */
+inline int count_leading_zeros(uint32_t x) {
+#if defined(__GNUC__)
+    return __builtin_clz(x);
+#else
+    int n = 0;
+    while (!(x & 0x80000000u)) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+
+/**
+ * @brief Returns a mask with the lowest `nbits` bits set, `nbits` in the range [0, 32].
+ */
+inline uint32_t low_bits_mask(int nbits) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(1) << nbits) - 1);
 }
 
 /**
@@ -42,6 +82,9 @@ uint32_t backward_value(uint32_t value, uint32_t low, uint32_t high) {
  */
 template <typename T>
 class ArithmeticEncoder {
+    using SymbolType = typename T::SymbolType;
+    using FrequencyType = typename T::FrequencyType;
+    using IntType = typename T::IntType;
 
 public:
     T model;
@@ -67,32 +110,26 @@ public:
         model.symbol_low_high(symbol, symbol_low, symbol_high);
 
         // rescale low and high
-        forward_range(low, high, symbol_low, symbol_high);
-
-        // write bits to output
-        while (true) {
-            if (high < T::Int50) {
-                // Output a '0' bit since the range is in the lower half
-                write_bits(0, bit_stream);
-            } else if (low >= T::Int50) {
-                // Output a '1' bit since the range is in the upper half
-                write_bits(1, bit_stream);
-            } else if (low >= T::Int25 && high < T::Int75) {
-                // Adjust the range when it straddles the midpoint
-                pending_bits++;
-                low -= T::Int25;
-                high -= T::Int25;
-            } else {
-                // Break the loop if no more bits can be output unambiguously
-                break;
-            }
-
-            // Shift the range left by one bit and expand the high range
-            low <<= 1;
-            low &= T::MAX_CODE;
+        forward_range<T>(low, high, symbol_low, symbol_high);
+
+        // The leading bits that low and high have in common can no longer change; output
+        // them all at once and shift them out of the range.
+        IntType diff = (low ^ high) << (32 - T::CODE_BITS);
+        int shift = diff ? count_leading_zeros(diff) : T::CODE_BITS;
+        if (shift > 0) {
+            write_bits(low >> (T::CODE_BITS - shift), shift, bit_stream);
+            low = (low << shift) & T::MAX_CODE;
+            high = ((high << shift) | low_bits_mask(shift)) & T::MAX_CODE;
+        }
 
-            high = (high << 1) | 1;
-            high &= T::MAX_CODE;
+        // Now low < Int50 <= high. While low = 01... and high = 10... the range straddles
+        // the midpoint, count those underflow bits and remove them from below the top bit.
+        IntType straddle = ((low & ~high) & (T::Int50 - 1)) << (32 - T::CODE_BITS + 1);
+        int underflow = count_leading_zeros(~straddle);
+        if (underflow > 0) {
+            pending_bits += underflow;
+            low = (low << underflow) & (T::Int50 - 1);
+            high = (((high << underflow) | low_bits_mask(underflow)) & (T::Int50 - 1)) | T::Int50;
         }
     }
 
@@ -105,32 +142,95 @@ public:
     void flush(OBitStream &bit_stream) {
         pending_bits++;
         if (low < T::Int25) {
-            write_bits(0, bit_stream);
+            write_bits(0, 1, bit_stream);
         } else {
-            write_bits(1, bit_stream);
+            write_bits(1, 1, bit_stream);
         }
     };
 
-private:
-    using SymbolType = typename T::SymbolType;
-    using FrequencyType = typename T::FrequencyType;
-    using IntType = typename T::IntType;
+    /**
+     * @brief Starts a new code word after flush(), keeping the model state.
+     */
+    void restart() {
+        low = 0;
+        high = T::MAX_CODE;
+        pending_bits = 0;
+    }
+
+    /**
+     * @brief The number of underflow bits waiting for the next resolved bit.
+     */
+    size_t pending() const {
+        return pending_bits;
+    }
+
+    /**
+     * @brief Saves the coder and model state, see checkpoint.hpp.
+     */
+    void save(CheckpointWriter &writer) const {
+        writer.put(bits_written, 8);
+        writer.put(symbols_written, 8);
+        writer.put(low, 4);
+        writer.put(high, 4);
+        writer.put(pending_bits, 8);
+        model.save(writer);
+    }
 
+    /**
+     * @brief Restores the coder and model state, continue with the bit stream state saved with it.
+     */
+    void restore(CheckpointReader &reader) {
+        bits_written = reader.get(8);
+        symbols_written = reader.get(8);
+        low = static_cast<IntType>(reader.get(4));
+        high = static_cast<IntType>(reader.get(4));
+        pending_bits = reader.get(8);
+        // every symbol leaves a range wider than a quarter and adds at most CODE_BITS pending bits
+        if (low > high || high > T::MAX_CODE || high - low < T::Int25 ||
+            pending_bits > T::CODE_BITS * symbols_written) {
+            throw std::runtime_error("Invalid coder checkpoint");
+        }
+        model.restore(reader);
+    }
+
+private:
     FrequencyType symbol_low, symbol_high;
     IntType low, high;
     size_t pending_bits;
 
     /**
      * @brief Writes bits to the output stream.
-     * 
-     * @param b The bit to write.
+     *
+     * The first bit resolves the pending underflow bits, which are written as its inverse
+     * directly after it, followed by the remaining bits.
+     *
+     * @param bits The bits to write, right aligned, most significant bit first.
+     * @param nbits The number of bits to write, in the range [1, CODE_BITS].
      * @param bit_stream The output bit stream to write to.
      */
-   void write_bits(const bool b, OBitStream &bit_stream) {
-        bits_written += 1 + pending_bits;
-        bit_stream.put(b);
-        for (int i=0; i<pending_bits; ++i)
-            bit_stream.put(!b);
+    void write_bits(const IntType bits, const int nbits, OBitStream &bit_stream) {
+        bits_written += nbits + pending_bits;
+
+        const uint32_t b = (bits >> (nbits - 1)) & 1;
+        const uint32_t inverted = b - 1; // all ones if b == 0
+
+        if (pending_bits + nbits <= 32) {
+            // common case: a single masked write
+            const int p = static_cast<int>(pending_bits);
+            bit_stream.put_bits(
+                (b << (p + nbits - 1)) |
+                ((inverted & low_bits_mask(p)) << (nbits - 1)) |
+                (bits & low_bits_mask(nbits - 1)),
+                p + nbits
+            );
+        } else {
+            bit_stream.put_bits(b, 1);
+            for (; pending_bits >= 32; pending_bits -= 32) {
+                bit_stream.put_bits(inverted, 32);
+            }
+            bit_stream.put_bits(inverted, static_cast<int>(pending_bits));
+            bit_stream.put_bits(bits, nbits - 1);
+        }
         pending_bits = 0;
     }
 };
@@ -139,6 +239,9 @@ private:
 
 template <typename T>
 class ArithmeticDecoder {
+    using SymbolType = typename T::SymbolType;
+    using FrequencyType = typename T::FrequencyType;
+    using IntType = typename T::IntType;
 
 public:
     size_t bits_read = 0;
@@ -150,19 +253,109 @@ public:
 
 
     SymbolType decode(IBitStream &bit_stream) {
+        symbols_read++;
+        return decode_step(bit_stream, low, high, value, bits_read);
+    }
+
+    /**
+     * @brief Decodes up to `n` symbols, each followed by model.update_state.
+     *
+     * The same as calling decode and update_state per symbol, but with the coder state in
+     * locals for the whole span. The stop symbol check is compiled out for models without one.
+     *
+     * @param bit_stream The coded input.
+     * @param out Receives the decoded symbols, without the stop symbol.
+     * @param n The maximum number of symbols to decode.
+     * @return The number of symbols written to `out`, fewer than `n` only after a stop symbol.
+     */
+    size_t decode_n(IBitStream &bit_stream, SymbolType *out, size_t n) {
+        IntType l = low, h = high, v = value;
+        size_t bits = bits_read;
+        size_t i = 0;
+        size_t stops = 0;
+        for (; i < n; ++i) {
+            const SymbolType symbol = decode_step(bit_stream, l, h, v, bits);
+            model.update_state(symbol);
+            if (T::HAS_STOP && symbol == T::STOP_SYMBOL) {
+                stops = 1;
+                break;
+            }
+            out[i] = symbol;
+        }
+        low = l;
+        high = h;
+        value = v;
+        bits_read = bits;
+        symbols_read += i + stops;
+        return i;
+    }
+
+    /**
+     * @brief Prepares for a new code word, keeping the model state. Call init() next.
+     */
+    void restart() {
+        low = 0;
+        high = T::MAX_CODE;
+        value = 0;
+    }
+
+    void init(IBitStream &bit_stream) {
         bool b;
-        SymbolType symbol;
+        value = 0;
+        for (int i=0; i<17; ++i) {
+            bit_stream.get(b);
+            value = (value << 1) | b;
+        }
+        bits_read += 17;
+    }
+
+    /**
+     * @brief Saves the coder and model state, see checkpoint.hpp.
+     */
+    void save(CheckpointWriter &writer) const {
+        writer.put(bits_read, 8);
+        writer.put(symbols_read, 8);
+        writer.put(low, 4);
+        writer.put(high, 4);
+        writer.put(value, 4);
+        model.save(writer);
+    }
+
+    /**
+     * @brief Restores the coder and model state, the bit stream continues after the bits_read
+     *        bits that were read before the checkpoint.
+     */
+    void restore(CheckpointReader &reader) {
+        bits_read = reader.get(8);
+        symbols_read = reader.get(8);
+        low = static_cast<IntType>(reader.get(4));
+        high = static_cast<IntType>(reader.get(4));
+        value = static_cast<IntType>(reader.get(4));
+        if (low > high || high > T::MAX_CODE || high - low < T::Int25 || value < low || value > high) {
+            throw std::runtime_error("Invalid coder checkpoint");
+        }
+        model.restore(reader);
+    }
+
+private:
+    IntType low, high, value;
+    size_t pending_bits;
+
+    // decodes one symbol from the coder state in low, high and value
+    SymbolType decode_step(IBitStream &bit_stream, IntType &low, IntType &high, IntType &value, size_t &bits_read) {
+        bool b;
+        FrequencyType symbol_low, symbol_high;
 
         // Lookup the symbol based in the frequency
-        uint32_t scaled_value = backward_value(value, low,  high);
+        uint32_t scaled_value = backward_value<T>(value, low, high);
 
-        symbol = model.frequency_symbol(scaled_value);
+        SymbolType symbol = model.frequency_symbol(scaled_value);
 
         // get the [low, high) cumulative frequency range of a symbol
         model.symbol_low_high(symbol, symbol_low, symbol_high);
 
         // rescale low and high
-        forward_range(low, high, symbol_low, symbol_high);
+        forward_range<T>(low, high, symbol_low, symbol_high);
 
         while (true) {
             if (high < T::Int50) {
@@ -183,28 +376,11 @@ public:
 
             bit_stream.get(b);
             value = (value << 1) | b;
+            bits_read++;
         }
 
         return symbol;
     }
-
-    void init(IBitStream &bit_stream) {
-        bool b;
-        value = 0;
-        for (int i=0; i<17; ++i) {
-            bit_stream.get(b);
-            value = (value << 1) | b;
-        }
-    }
-
-private:
-    using SymbolType = typename T::SymbolType;
-    using FrequencyType = typename T::FrequencyType;
-    using IntType = typename T::IntType;
-
-    FrequencyType symbol_low, symbol_high;
-    IntType low, high, value;
-    size_t pending_bits;
 };
 
 #endif
\ No newline at end of file
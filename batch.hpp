@@ -0,0 +1,626 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include "neuralink.hpp"
+#include "bitstream.hpp"
+#include "multichannel.hpp"
+#include "threadpool.hpp"
+
+/*
+ * Batched model state
+ *
+ * In a multi-channel recording every channel runs the same mean and stdev recursion of
+ * BasicModel::update_state on every frame. BasicModelBatch keeps the state of a group of
+ * channels in separate contiguous arrays (structure of arrays) and updates all of them with
+ * one call per frame. The outlier filter becomes a lane mask and the std_levels lookup a sum
+ * of vector compares, so the AVX2 kernel updates 4 channels and the AVX-512 kernel 8 channels
+ * per instruction, selected at runtime like the sample conversion kernels.
+ *
+ * The kernels evaluate the recursion in double precision with the operations in the order of
+ * update_state, so every channel follows exactly the state sequence of its own BasicModel and
+ * the substreams are identical to the ones of MultiChannelEncoder.
+ */
+
+
+// number of channels updated per AVX-512 instruction, the unit of the channel groups
+static const size_t MODEL_BATCH_WIDTH = 8;
+
+// largest group of channels with one batch, the groups are the work items of the thread pool
+static const size_t MODEL_BATCH_MAX_GROUP = 256;
+
+
+/**
+ * @brief The constants of the state recursion of BasicModel, broadcast to every channel.
+ */
+struct ModelBatchConstants {
+    static const uint16_t NUM_DIST = ModelParameters::NUM_DIST;
+
+    double ma;
+    double one_minus_ma;
+    double omega;
+    double alpha;
+    double beta;
+    double outlier_level;
+    double mrr;
+    std::array<double, NUM_DIST> std_levels;
+
+    explicit ModelBatchConstants(const ModelParameters &params = ModelParameters())
+        : ma(params.ma), one_minus_ma(1 - params.ma),
+          omega(params.ltv / (1 - params.alpha - params.beta)),
+          alpha(params.alpha), beta(params.beta), outlier_level(params.outlier_level),
+          mrr(params.mrr), std_levels(params.std_levels) {}
+};
+
+
+/**
+ * @brief Pointers to the per-channel state arrays of a batch.
+ *
+ * The outlier counter is kept as a double so the kernels mask it with the other lanes. The
+ * distribution index and symbol shift are the values that BasicModel keeps in active_dist
+ * and active_symbol_shift.
+ */
+struct ModelBatchState {
+    double *mean;
+    double *stdev;
+    double *outliers;
+    int32_t *dist;
+    int32_t *shift;
+};
+
+
+/**
+ * @brief Updates the state of channels [begin, count) with their next symbol, one at a time.
+ *
+ * This is BasicModel::update_state on the state arrays, and the reference of the SIMD kernels.
+ */
+inline void model_batch_update_scalar(const ModelBatchConstants &k, const SymbolType *symbols, const ModelBatchState &s, size_t begin, size_t count) {
+    for (size_t i = begin; i < count; ++i) {
+        const SymbolType symbol = symbols[i];
+        const double ds = symbol - s.mean[i];
+
+        // outlier filter
+        double outliers = std::abs(ds) > k.outlier_level * s.stdev[i] ? s.outliers[i] + 1 : 0;
+        if (outliers > 3) {
+            outliers = 0;
+        }
+        s.outliers[i] = outliers;
+
+        // update mean & std
+        if (outliers == 0) {
+            const double mean = k.ma * s.mean[i] + k.one_minus_ma * symbol;
+            const double stdev = std::sqrt(k.omega + k.alpha * s.stdev[i] * s.stdev[i] + k.beta * ds * ds);
+
+            // lower_bound over std_levels, limited to the last distribution
+            int32_t dist = 0;
+            for (int d = 0; d + 1 < ModelBatchConstants::NUM_DIST; ++d) {
+                dist += k.std_levels[d] < stdev;
+            }
+
+            s.mean[i] = mean;
+            s.stdev[i] = stdev;
+            s.dist[i] = dist;
+            s.shift[i] = static_cast<int16_t>(511 - static_cast<SymbolType>(mean + (symbol - mean) * k.mrr));
+        }
+    }
+}
+
+
+#if defined(NEUROMASTERBLASTER_X86_DISPATCH)
+
+__attribute__((target("avx2")))
+inline size_t model_batch_update_avx2(const ModelBatchConstants &k, const SymbolType *symbols, const ModelBatchState &s, size_t count) {
+    const __m256d ma = _mm256_set1_pd(k.ma);
+    const __m256d one_minus_ma = _mm256_set1_pd(k.one_minus_ma);
+    const __m256d omega = _mm256_set1_pd(k.omega);
+    const __m256d alpha = _mm256_set1_pd(k.alpha);
+    const __m256d beta = _mm256_set1_pd(k.beta);
+    const __m256d outlier_level = _mm256_set1_pd(k.outlier_level);
+    const __m256d mrr = _mm256_set1_pd(k.mrr);
+    const __m256d zero = _mm256_setzero_pd();
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d three = _mm256_set1_pd(3.0);
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m128i center = _mm_set1_epi32(511);
+    const __m128i low16 = _mm_set1_epi32(0xFFFF);
+    const __m256i even = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+    __m256d levels[ModelBatchConstants::NUM_DIST - 1];
+    for (int d = 0; d + 1 < ModelBatchConstants::NUM_DIST; ++d) {
+        levels[d] = _mm256_set1_pd(k.std_levels[d]);
+    }
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i u = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(symbols + i)));
+        __m256d symbol = _mm256_cvtepi32_pd(u);
+        __m256d mean = _mm256_loadu_pd(s.mean + i);
+        __m256d stdev = _mm256_loadu_pd(s.stdev + i);
+        __m256d ds = _mm256_sub_pd(symbol, mean);
+
+        // outlier filter, the lanes with a zero counter are updated
+        __m256d outlier = _mm256_cmp_pd(_mm256_andnot_pd(sign, ds), _mm256_mul_pd(outlier_level, stdev), _CMP_GT_OQ);
+        __m256d outliers = _mm256_and_pd(outlier, _mm256_add_pd(_mm256_loadu_pd(s.outliers + i), one));
+        outliers = _mm256_andnot_pd(_mm256_cmp_pd(outliers, three, _CMP_GT_OQ), outliers);
+        _mm256_storeu_pd(s.outliers + i, outliers);
+        __m256d update = _mm256_cmp_pd(outliers, zero, _CMP_EQ_OQ);
+
+        // update mean & std
+        __m256d new_mean = _mm256_add_pd(_mm256_mul_pd(ma, mean), _mm256_mul_pd(one_minus_ma, symbol));
+        __m256d new_stdev = _mm256_sqrt_pd(_mm256_add_pd(
+            _mm256_add_pd(omega, _mm256_mul_pd(_mm256_mul_pd(alpha, stdev), stdev)),
+            _mm256_mul_pd(_mm256_mul_pd(beta, ds), ds)
+        ));
+        __m256d dist = zero;
+        for (int d = 0; d + 1 < ModelBatchConstants::NUM_DIST; ++d) {
+            dist = _mm256_add_pd(dist, _mm256_and_pd(_mm256_cmp_pd(levels[d], new_stdev, _CMP_LT_OQ), one));
+        }
+        __m256d target = _mm256_add_pd(new_mean, _mm256_mul_pd(_mm256_sub_pd(symbol, new_mean), mrr));
+        __m128i shift = _mm_sub_epi32(center, _mm_and_si128(_mm256_cvttpd_epi32(target), low16));
+        shift = _mm_srai_epi32(_mm_slli_epi32(shift, 16), 16);
+
+        // the 64 bit lane mask narrowed to the 32 bit lanes of dist and shift
+        __m128i update32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(update), even));
+        __m128i old_dist = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.dist + i));
+        __m128i old_shift = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s.shift + i));
+
+        _mm256_storeu_pd(s.mean + i, _mm256_blendv_pd(mean, new_mean, update));
+        _mm256_storeu_pd(s.stdev + i, _mm256_blendv_pd(stdev, new_stdev, update));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(s.dist + i), _mm_blendv_epi8(old_dist, _mm256_cvttpd_epi32(dist), update32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(s.shift + i), _mm_blendv_epi8(old_shift, shift, update32));
+    }
+    return i;
+}
+
+// GCC 12 reports the _mm512_undefined_* placeholders inside its AVX-512 intrinsics as uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f")))
+inline size_t model_batch_update_avx512(const ModelBatchConstants &k, const SymbolType *symbols, const ModelBatchState &s, size_t count) {
+    const __m512d ma = _mm512_set1_pd(k.ma);
+    const __m512d one_minus_ma = _mm512_set1_pd(k.one_minus_ma);
+    const __m512d omega = _mm512_set1_pd(k.omega);
+    const __m512d alpha = _mm512_set1_pd(k.alpha);
+    const __m512d beta = _mm512_set1_pd(k.beta);
+    const __m512d outlier_level = _mm512_set1_pd(k.outlier_level);
+    const __m512d mrr = _mm512_set1_pd(k.mrr);
+    const __m512d zero = _mm512_setzero_pd();
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d three = _mm512_set1_pd(3.0);
+    const __m256i center = _mm256_set1_epi32(511);
+    const __m256i low16 = _mm256_set1_epi32(0xFFFF);
+    __m512d levels[ModelBatchConstants::NUM_DIST - 1];
+    for (int d = 0; d + 1 < ModelBatchConstants::NUM_DIST; ++d) {
+        levels[d] = _mm512_set1_pd(k.std_levels[d]);
+    }
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i u = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(symbols + i)));
+        __m512d symbol = _mm512_cvtepi32_pd(u);
+        __m512d mean = _mm512_loadu_pd(s.mean + i);
+        __m512d stdev = _mm512_loadu_pd(s.stdev + i);
+        __m512d ds = _mm512_sub_pd(symbol, mean);
+
+        // outlier filter, the lanes with a zero counter are updated
+        __mmask8 outlier = _mm512_cmp_pd_mask(_mm512_abs_pd(ds), _mm512_mul_pd(outlier_level, stdev), _CMP_GT_OQ);
+        __m512d outliers = _mm512_maskz_add_pd(outlier, _mm512_loadu_pd(s.outliers + i), one);
+        outliers = _mm512_mask_mov_pd(outliers, _mm512_cmp_pd_mask(outliers, three, _CMP_GT_OQ), zero);
+        _mm512_storeu_pd(s.outliers + i, outliers);
+        __mmask8 update = _mm512_cmp_pd_mask(outliers, zero, _CMP_EQ_OQ);
+
+        // update mean & std
+        __m512d new_mean = _mm512_add_pd(_mm512_mul_pd(ma, mean), _mm512_mul_pd(one_minus_ma, symbol));
+        __m512d new_stdev = _mm512_sqrt_pd(_mm512_add_pd(
+            _mm512_add_pd(omega, _mm512_mul_pd(_mm512_mul_pd(alpha, stdev), stdev)),
+            _mm512_mul_pd(_mm512_mul_pd(beta, ds), ds)
+        ));
+        __m512d dist = zero;
+        for (int d = 0; d + 1 < ModelBatchConstants::NUM_DIST; ++d) {
+            dist = _mm512_mask_add_pd(dist, _mm512_cmp_pd_mask(levels[d], new_stdev, _CMP_LT_OQ), dist, one);
+        }
+        __m512d target = _mm512_add_pd(new_mean, _mm512_mul_pd(_mm512_sub_pd(symbol, new_mean), mrr));
+        __m256i shift = _mm256_sub_epi32(center, _mm256_and_si256(_mm512_cvttpd_epi32(target), low16));
+        shift = _mm256_srai_epi32(_mm256_slli_epi32(shift, 16), 16);
+
+        _mm512_mask_storeu_pd(s.mean + i, update, new_mean);
+        _mm512_mask_storeu_pd(s.stdev + i, update, new_stdev);
+        _mm512_mask_storeu_epi32(s.dist + i, update, _mm512_castsi256_si512(_mm512_cvttpd_epi32(dist)));
+        _mm512_mask_storeu_epi32(s.shift + i, update, _mm512_castsi256_si512(shift));
+    }
+    return i;
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+
+/**
+ * @brief Updates the state of `count` channels with their next symbol.
+ *
+ * The kernel is selected by neuralink_simd(), the channels after the last full vector are
+ * updated by the scalar kernel.
+ */
+inline void model_batch_update(const ModelBatchConstants &k, const SymbolType *symbols, const ModelBatchState &s, size_t count) {
+    size_t i = 0;
+#if defined(NEUROMASTERBLASTER_X86_DISPATCH)
+    switch (neuralink_simd()) {
+    case NeuralinkSimd::AVX512: i = model_batch_update_avx512(k, symbols, s, count); break;
+    case NeuralinkSimd::AVX2:   i = model_batch_update_avx2(k, symbols, s, count); break;
+    default: break;
+    }
+#endif
+    model_batch_update_scalar(k, symbols, s, i, count);
+}
+
+
+/**
+ * @brief The number of channels per batch, a multiple of MODEL_BATCH_WIDTH.
+ *
+ * The channels are spread evenly over the threads, in groups of at most MODEL_BATCH_MAX_GROUP.
+ */
+inline size_t model_batch_group_size(size_t channels, size_t threads) {
+    size_t size = (channels + threads - 1) / std::max<size_t>(threads, 1);
+    size = (size + MODEL_BATCH_WIDTH - 1) / MODEL_BATCH_WIDTH * MODEL_BATCH_WIDTH;
+    return std::max(MODEL_BATCH_WIDTH, std::min(size, MODEL_BATCH_MAX_GROUP));
+}
+
+
+/**
+ * @brief The states of the BasicModel of a group of channels, in SoA arrays.
+ *
+ * All channels share the constants and the tables of one model. A Channel is the view of one
+ * channel that the coders use as their model, the state is advanced for all channels at
+ * once by update(), instead of by update_state() of every coder's model.
+ *
+ * @tparam TOTAL_FREQUENCY The total of the cumulative frequency tables, see BasicModel.
+ */
+template <uint32_t TOTAL_FREQUENCY>
+class BasicModelBatch {
+public:
+    using Model = BasicModel<TOTAL_FREQUENCY>;
+    using SymbolType = typename Model::SymbolType;
+    using FrequencyType = typename Model::FrequencyType;
+    using IntType = typename Model::IntType;
+    static const uint16_t NUM_DIST = Model::NUM_DIST;
+
+    /**
+     * @brief The model of a single channel of a batch, for the coders.
+     */
+    class Channel {
+    public:
+        using SymbolType = typename Model::SymbolType;
+        using FrequencyType = typename Model::FrequencyType;
+        using IntType = typename Model::IntType;
+
+        static constexpr SymbolType NUM_SYMBOLS = Model::NUM_SYMBOLS;
+        static constexpr bool HAS_STOP = Model::HAS_STOP;
+        static constexpr SymbolType STOP_SYMBOL = Model::STOP_SYMBOL;
+        static constexpr FrequencyType MAX_FREQUENCY = Model::MAX_FREQUENCY;
+        static constexpr int CODE_BITS = Model::CODE_BITS;
+        static constexpr IntType MAX_CODE = Model::MAX_CODE;
+        static constexpr IntType Int25 = Model::Int25;
+        static constexpr IntType Int50 = Model::Int50;
+        static constexpr IntType Int75 = Model::Int75;
+
+        Channel() = default;
+        Channel(const BasicModelBatch *batch, size_t channel) : batch(batch), channel(channel) {}
+
+        void symbol_low_high(const SymbolType symbol, FrequencyType &low, FrequencyType &high) const {
+            batch->symbol_low_high(channel, symbol, low, high);
+        }
+
+        SymbolType frequency_symbol(FrequencyType freq) const {
+            return batch->frequency_symbol(channel, freq);
+        }
+
+    private:
+        const BasicModelBatch *batch = nullptr;
+        size_t channel = 0;
+    };
+
+    /**
+     * @param channels The number of channels.
+     * @param model The model whose constants, tables and state every channel starts with. The
+     *        tables are not copied and must outlive the batch.
+     */
+    BasicModelBatch(size_t channels, const Model &model)
+        : constants(model.params), ccft_rows(model.ccft_rows), lookup_rows(model.lookup_rows),
+          mean(channels, model.mean), stdev(channels, model.stdev),
+          outliers(channels, model.outlier_counter), dist(channels, model.active_dist),
+          shift(channels, model.active_symbol_shift) {}
+
+    size_t channels() const {
+        return mean.size();
+    }
+
+    /**
+     * @brief The coder model of channel c, valid as long as the batch.
+     */
+    Channel channel(size_t c) const {
+        return Channel(this, c);
+    }
+
+    /**
+     * @brief Updates the state of the first `count` channels, BasicModel::update_state of each.
+     *
+     * @param symbols The next symbol of every channel.
+     * @param count The number of channels to update, at most channels().
+     */
+    void update(const SymbolType *symbols, size_t count) {
+        const ModelBatchState state = {mean.data(), stdev.data(), outliers.data(), dist.data(), shift.data()};
+        model_batch_update(constants, symbols, state, count);
+    }
+
+    void symbol_low_high(size_t c, const SymbolType symbol, FrequencyType &low, FrequencyType &high) const {
+        Model::row_low_high(ccft_rows[dist[c]], static_cast<int16_t>(shift[c]), symbol, low, high);
+    }
+
+    SymbolType frequency_symbol(size_t c, FrequencyType freq) const {
+        return Model::row_symbol(ccft_rows[dist[c]], lookup_rows[dist[c]], static_cast<int16_t>(shift[c]), freq);
+    }
+
+private:
+    ModelBatchConstants constants;
+    std::array<const FrequencyType*, NUM_DIST> ccft_rows;
+    std::array<const SymbolType*, NUM_DIST> lookup_rows;
+
+    // per-channel state
+    std::vector<double> mean;
+    std::vector<double> stdev;
+    std::vector<double> outliers;
+    std::vector<int32_t> dist;
+    std::vector<int32_t> shift;
+};
+
+
+/**
+ * @brief MultiChannelEncoder for BasicModel channels, with the states updated in batches.
+ *
+ * The channels are split into groups with one BasicModelBatch each, and the thread pool codes
+ * the groups concurrently. A group is coded frame by frame: every channel codes its symbol,
+ * then the batch updates the states of all channels of the group. The payload is the same as
+ * the one of MultiChannelEncoder with the same model.
+ *
+ * @tparam Encoder The coder engine, ArithmeticEncoder or RangeEncoder.
+ * @tparam TOTAL_FREQUENCY The total of the cumulative frequency tables, see BasicModel.
+ */
+template <template <typename> class Encoder, uint32_t TOTAL_FREQUENCY>
+class MultiChannelBatchEncoder {
+    using Batch = BasicModelBatch<TOTAL_FREQUENCY>;
+    using Channel = typename Batch::Channel;
+    using SymbolType = typename Batch::SymbolType;
+    static_assert(Channel::HAS_STOP, "The substreams end with a stop symbol");
+
+public:
+    /**
+     * @param channels The number of interleaved channels.
+     * @param threads The number of threads of the pool that codes the channels.
+     * @param model The initial model of every channel.
+     */
+    MultiChannelBatchEncoder(size_t channels, size_t threads, const BasicModel<TOTAL_FREQUENCY> &model)
+        : group_size(model_batch_group_size(channels, threads)), coders(channels), bitstreams(channels) {
+        for (size_t begin = 0; begin < channels; begin += group_size) {
+            batches.emplace_back(new Batch(std::min(group_size, channels - begin), model));
+        }
+        for (size_t c = 0; c < channels; ++c) {
+            coders[c].model = batches[c / group_size]->channel(c % group_size);
+        }
+    }
+
+    size_t channels() const {
+        return coders.size();
+    }
+
+    /**
+     * @brief Encodes a chunk of interleaved symbols.
+     *
+     * @param symbols The interleaved symbols, starting at channel 0.
+     * @param count The number of symbols, a multiple of the channel count except for the last chunk.
+     * @param pool The threads that code the channel groups.
+     */
+    void encode(const SymbolType *symbols, size_t count, ThreadPool &pool) {
+        pool.parallel_for(batches.size(), [this, symbols, count](size_t g) {
+            encode_group(g, symbols, count);
+        });
+    }
+
+    /**
+     * @brief Terminates every substream with a stop symbol.
+     */
+    void finish() {
+        for (size_t c = 0; c < coders.size(); ++c) {
+            coders[c].encode(Channel::STOP_SYMBOL, bitstreams[c]);
+            coders[c].flush(bitstreams[c]);
+            bitstreams[c].flush();
+        }
+    }
+
+    /**
+     * @brief Writes the substream size table followed by the substreams, call after finish().
+     */
+    void write(std::ostream &outputStream) const {
+        multichannel_write(outputStream, bitstreams);
+    }
+
+    /**
+     * @brief Appends the substream size table followed by the substreams to a byte buffer.
+     */
+    void write(std::vector<uint8_t> &bytes) const {
+        multichannel_write(bytes, bitstreams);
+    }
+
+private:
+    size_t group_size;
+    std::vector<std::unique_ptr<Batch>> batches;
+    std::vector<Encoder<Channel>> coders;
+    std::vector<OBitStream> bitstreams;
+
+    void encode_group(size_t g, const SymbolType *symbols, size_t count) {
+        Batch &batch = *batches[g];
+        const size_t num_channels = coders.size();
+        const size_t begin = g * group_size;
+        for (size_t offset = begin; offset < count; offset += num_channels) {
+            const SymbolType *frame = symbols + offset;
+            const size_t n = std::min(batch.channels(), count - offset);
+            for (size_t c = 0; c < n; ++c) {
+                coders[begin + c].encode(frame[c], bitstreams[begin + c]);
+            }
+            batch.update(frame, n);
+        }
+    }
+};
+
+
+/**
+ * @brief MultiChannelDecoder for BasicModel channels, with the states updated in batches.
+ *
+ * Decodes the payload of MultiChannelEncoder or MultiChannelBatchEncoder, see
+ * MultiChannelBatchEncoder for the channel groups.
+ *
+ * @tparam Decoder The coder engine, ArithmeticDecoder or RangeDecoder.
+ * @tparam TOTAL_FREQUENCY The total of the cumulative frequency tables, see BasicModel.
+ */
+template <template <typename> class Decoder, uint32_t TOTAL_FREQUENCY>
+class MultiChannelBatchDecoder {
+    using Batch = BasicModelBatch<TOTAL_FREQUENCY>;
+    using Channel = typename Batch::Channel;
+    using SymbolType = typename Batch::SymbolType;
+    static_assert(Channel::HAS_STOP, "The substreams end with a stop symbol");
+
+public:
+    /**
+     * @param channels The number of interleaved channels.
+     * @param threads The number of threads of the pool that decodes the channels.
+     * @param model The initial model of every channel, the same as the one of the encoder.
+     */
+    MultiChannelBatchDecoder(size_t channels, size_t threads, const BasicModel<TOTAL_FREQUENCY> &model)
+        : group_size(model_batch_group_size(channels, threads)), coders(channels),
+          channel_symbols(channels), finished(channels, 0) {
+        for (size_t begin = 0; begin < channels; begin += group_size) {
+            batches.emplace_back(new Batch(std::min(group_size, channels - begin), model));
+            group_frames.emplace_back(batches.back()->channels(), 0);
+        }
+        for (size_t c = 0; c < channels; ++c) {
+            coders[c].model = batches[c / group_size]->channel(c % group_size);
+        }
+    }
+
+    /**
+     * @brief Reads the substream size table and all substreams into memory.
+     *
+     * @throws std::runtime_error if the payload is truncated.
+     */
+    void read(std::istream &inputStream) {
+        std::vector<uint8_t> sizes;
+        multichannel_read(inputStream, coders.size(), sizes, payload);
+        attach(sizes.data());
+    }
+
+    /**
+     * @brief Copies a multi-channel payload, the size table followed by the substreams, from memory.
+     *
+     * @throws std::runtime_error if the payload is truncated.
+     */
+    void read(const uint8_t *bytes, size_t size) {
+        std::vector<uint8_t> sizes;
+        multichannel_read(bytes, size, coders.size(), sizes, payload);
+        attach(sizes.data());
+    }
+
+    /**
+     * @brief Decodes up to `frames` symbols of every channel and interleaves them.
+     *
+     * @param symbols Receives the interleaved symbols, room for `frames` times the channel count.
+     * @param frames The maximum number of symbols to decode per channel.
+     * @param pool The threads that decode the channel groups.
+     * @return The number of symbols decoded, 0 when all channels are finished.
+     */
+    size_t decode(SymbolType *symbols, size_t frames, ThreadPool &pool) {
+        pool.parallel_for(batches.size(), [this, frames](size_t g) {
+            decode_group(g, frames);
+        });
+        return multichannel_interleave(channel_symbols, frames, symbols);
+    }
+
+private:
+    size_t group_size;
+    std::vector<std::unique_ptr<Batch>> batches;
+    std::vector<std::vector<SymbolType>> group_frames;  // the last decoded frame of every group
+    std::vector<Decoder<Channel>> coders;
+    std::vector<IBitStream> bitstreams;
+    std::vector<std::vector<SymbolType>> channel_symbols;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> finished; // not a vector<bool>, groups are decoded concurrently
+
+    void decode_group(size_t g, size_t count) {
+        Batch &batch = *batches[g];
+        SymbolType *frame = group_frames[g].data();
+        const size_t begin = g * group_size;
+        const size_t n = batch.channels();
+        for (size_t c = begin; c < begin + n; ++c) {
+            channel_symbols[c].clear();
+        }
+
+        // the states of finished channels are still updated, with their last symbol
+        for (size_t t = 0; t < count; ++t) {
+            size_t active = 0;
+            for (size_t c = 0; c < n; ++c) {
+                if (finished[begin + c]) {
+                    continue;
+                }
+                const SymbolType symbol = coders[begin + c].decode(bitstreams[begin + c]);
+                if (symbol == Channel::STOP_SYMBOL) {
+                    finished[begin + c] = 1;
+                } else {
+                    channel_symbols[begin + c].push_back(symbol);
+                    active++;
+                }
+                frame[c] = symbol;
+            }
+            if (active == 0) {
+                break;
+            }
+            batch.update(frame, n);
+        }
+    }
+
+    // points the per-channel bitstreams into the payload and starts the coders
+    void attach(const uint8_t *sizes) {
+        const size_t num_channels = coders.size();
+        bitstreams.clear();
+        bitstreams.reserve(num_channels);
+        size_t offset = 0;
+        for (size_t c = 0; c < num_channels; ++c) {
+            const size_t size = multichannel_get_u32(&sizes[4 * c]);
+            bitstreams.emplace_back(payload.data() + offset, size);
+            coders[c].init(bitstreams[c]);
+            offset += size;
+        }
+    }
+};
+
+#endif
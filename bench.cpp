@@ -0,0 +1,444 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "wav.hpp"
+#include "neuralink.hpp"
+#include "bitstream.hpp"
+#include "arithmetic_coding.hpp"
+#include "range_coding.hpp"
+#include "stats.hpp"
+
+
+/*
+ * Benchmarks of the coder hot paths and of the model variants.
+ *
+ * Usage: benchmark [--micro | --models] [file.wav ...]
+ *
+ * The micro benchmarks time the model and coder operations that run once per sample, and
+ * report the throughput and the p50, p99 and p99.9 latency of a single call. The model
+ * benchmark codes every recording into memory with each model, checks the round trip, and
+ * reports the compression ratio and speed. A synthetic recording is always included.
+ */
+
+
+// number of timed repetitions, the fastest one is reported
+static constexpr int REPETITIONS = 5;
+
+
+using Clock = std::chrono::steady_clock;
+
+// keeps the compiler from dropping benchmark loops whose results are otherwise unused
+static volatile uint32_t sink;
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+std::vector<SymbolType> readSymbols(const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Error opening input file: " + path);
+    }
+    neuralink_check_wav_header(read_wav_header(input));
+
+    std::vector<int16_t> samples;
+    std::vector<int16_t> chunk(1 << 16);
+    size_t count;
+    while ((count = neuralink_read_samples_from_stream(input, chunk.data(), chunk.size())) > 0) {
+        samples.insert(samples.end(), chunk.begin(), chunk.begin() + count);
+    }
+
+    std::vector<SymbolType> symbols(samples.size());
+    neuralink_16bit_to_10bit(samples.data(), symbols.data(), samples.size());
+    return symbols;
+}
+
+
+// AR(1) noise around the mid level with occasional spikes
+std::vector<SymbolType> syntheticSymbols(size_t count) {
+    std::mt19937 rng(1);
+    std::normal_distribution<double> noise(0.0, 12.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<SymbolType> symbols(count);
+    double x = 0;
+    for (size_t i = 0; i < count; ++i) {
+        x = 0.6 * x + noise(rng);
+        double y = x + (uniform(rng) < 0.001 ? 200.0 : 0.0);
+        symbols[i] = static_cast<SymbolType>(std::min(1023.0, std::max(0.0, std::round(511 + y))));
+    }
+    return symbols;
+}
+
+
+template <typename M>
+double benchUpdateState(const std::vector<SymbolType> &symbols) {
+    double best = 1e30;
+    for (int r = 0; r < REPETITIONS; ++r) {
+        M model;
+        FrequencyType low = 0, high = 0, checksum = 0;
+        Clock::time_point start = Clock::now();
+        for (SymbolType symbol : symbols) {
+            model.update_state(symbol);
+            model.symbol_low_high(symbol, low, high);
+            checksum ^= low;
+        }
+        best = std::min(best, secondsSince(start));
+        sink = checksum;
+    }
+    return best;
+}
+
+
+template <typename M>
+void benchModel(const char *name, const std::vector<SymbolType> &symbols) {
+    double encode_seconds = 1e30;
+    double decode_seconds = 1e30;
+    size_t bytes = 0;
+    std::vector<SymbolType> decoded(symbols.size() + 1);
+
+    for (int r = 0; r < REPETITIONS; ++r) {
+        OBitStream output;
+        Clock::time_point start = Clock::now();
+        ArithmeticEncoder<M> encoder;
+        for (SymbolType symbol : symbols) {
+            encoder.encode(symbol, output);
+            encoder.model.update_state(symbol);
+        }
+        encoder.encode(M::STOP_SYMBOL, output);
+        encoder.flush(output);
+        output.flush();
+        encode_seconds = std::min(encode_seconds, secondsSince(start));
+        bytes = output.size();
+
+        IBitStream input(output.data(), output.size());
+        start = Clock::now();
+        ArithmeticDecoder<M> decoder;
+        decoder.init(input);
+        const size_t count = decoder.decode_n(input, decoded.data(), decoded.size());
+        decode_seconds = std::min(decode_seconds, secondsSince(start));
+        if (count != symbols.size() || !std::equal(symbols.begin(), symbols.end(), decoded.begin())) {
+            throw std::runtime_error(std::string(name) + " round trip failed");
+        }
+    }
+
+    const double n = static_cast<double>(symbols.size());
+    std::cout << "  " << std::left << std::setw(8) << name << std::right << std::fixed
+              << std::setw(10) << std::setprecision(3) << (n * 2.0 / std::max<size_t>(bytes, 1)) << "x"
+              << std::setw(12) << std::setprecision(2) << (benchUpdateState<M>(symbols) / n * 1e9)
+              << std::setw(12) << (encode_seconds / n * 1e9)
+              << std::setw(12) << (decode_seconds / n * 1e9) << std::endl;
+}
+
+
+struct MicroResult {
+    double ns_per_sample;
+    double p50, p99, p999; // latency of a single call in ns
+};
+
+
+/**
+ * @brief Times a benchmark over all samples, best of REPETITIONS, and once per single call.
+ *
+ * A benchmark B provides reset(), which restores its initial state, and run(i), which performs
+ * the operation for sample i. The samples must be run in order.
+ */
+template <typename B>
+MicroResult measure(B &bench, size_t count) {
+    MicroResult result;
+
+    double best = 1e30;
+    for (int r = 0; r < REPETITIONS; ++r) {
+        bench.reset();
+        const Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < count; ++i) {
+            bench.run(i);
+        }
+        best = std::min(best, secondsSince(start));
+    }
+    result.ns_per_sample = best / count * 1e9;
+
+    std::vector<uint64_t> latency(count);
+    const uint64_t overhead = tick_overhead();
+    bench.reset();
+    for (size_t i = 0; i < count; ++i) {
+        const uint64_t t0 = read_ticks();
+        bench.run(i);
+        const uint64_t t = read_ticks() - t0;
+        latency[i] = t > overhead ? t - overhead : 0;
+    }
+
+    auto percentile = [&](double p) {
+        std::vector<uint64_t>::iterator it = latency.begin() + static_cast<size_t>(p * (count - 1));
+        std::nth_element(latency.begin(), it, latency.end());
+        return static_cast<double>(*it) * nanoseconds_per_tick();
+    };
+    result.p50 = percentile(0.5);
+    result.p99 = percentile(0.99);
+    result.p999 = percentile(0.999);
+    return result;
+}
+
+
+void printMicro(const char *name, const MicroResult &r) {
+    std::cout << "  " << std::left << std::setw(32) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << r.ns_per_sample
+              << std::setw(12) << (1e3 / r.ns_per_sample)
+              << std::setw(10) << r.p50
+              << std::setw(10) << r.p99
+              << std::setw(10) << r.p999 << std::endl;
+}
+
+
+// Model::update_state on the recording
+template <typename M>
+struct UpdateStateBench {
+    const std::vector<SymbolType> &symbols;
+    M model;
+
+    void reset() { model = M(); }
+    void run(size_t i) { model.update_state(symbols[i]); }
+};
+
+
+// number of recorded model states that the lookup benchmarks cycle through, small enough to stay in cache
+static constexpr size_t STATE_WINDOW = 1 << 12;
+
+
+// Model::symbol_low_high in recorded model states of the recording
+template <typename M>
+struct SymbolLowHighBench {
+    std::vector<M> states;
+    std::vector<SymbolType> symbols;
+    FrequencyType low = 0, high = 0;
+
+    SymbolLowHighBench(const std::vector<SymbolType> &recording) {
+        M model;
+        for (size_t i = 0; i < std::min(STATE_WINDOW, recording.size()); ++i) {
+            states.push_back(model);
+            symbols.push_back(recording[i]);
+            model.update_state(recording[i]);
+        }
+    }
+    void reset() {}
+    void run(size_t i) {
+        const size_t k = i % states.size();
+        states[k].symbol_low_high(symbols[k], low, high);
+        sink = low;
+    }
+};
+
+
+// Model::frequency_symbol of a frequency inside the range of the next sample, in recorded model states
+template <typename M>
+struct FrequencySymbolBench {
+    std::vector<M> states;
+    std::vector<FrequencyType> frequencies;
+
+    FrequencySymbolBench(const std::vector<SymbolType> &recording) {
+        M model;
+        FrequencyType low, high;
+        for (size_t i = 0; i < std::min(STATE_WINDOW, recording.size()); ++i) {
+            states.push_back(model);
+            model.symbol_low_high(recording[i], low, high);
+            frequencies.push_back(static_cast<FrequencyType>((low + high) / 2));
+            model.update_state(recording[i]);
+        }
+    }
+    void reset() {}
+    void run(size_t i) {
+        const size_t k = i % states.size();
+        sink = states[k].frequency_symbol(frequencies[k]);
+    }
+};
+
+
+// encode(symbol) followed by update_state, the per-sample step of the encoder
+template <template <typename> class Encoder, typename M>
+struct EncodeBench {
+    const std::vector<SymbolType> &symbols;
+    Encoder<M> coder;
+    OBitStream bitstream;
+
+    EncodeBench(const std::vector<SymbolType> &symbols) : symbols(symbols), bitstream(2 * symbols.size() + 64) {}
+    void reset() {
+        coder = Encoder<M>();
+        bitstream.clear();
+    }
+    void run(size_t i) {
+        coder.encode(symbols[i], bitstream);
+        coder.model.update_state(symbols[i]);
+    }
+};
+
+
+// EntropyEstimator::add of one symbol, the per-sample step of encode --estimate
+template <typename M>
+struct EstimateBench {
+    const std::vector<SymbolType> &symbols;
+    EntropyEstimator<M> estimator;
+
+    EstimateBench(const std::vector<SymbolType> &symbols) : symbols(symbols) {}
+    void reset() { estimator = EntropyEstimator<M>(); }
+    void run(size_t i) { estimator.add(&symbols[i], 1); }
+};
+
+
+// decode followed by update_state, the per-sample step of the decoder
+template <template <typename> class Encoder, template <typename> class Decoder, typename M>
+struct DecodeBench {
+    std::vector<uint8_t> bytes;
+    Decoder<M> coder;
+    IBitStream bitstream;
+
+    DecodeBench(const std::vector<SymbolType> &symbols) : bitstream(nullptr, 0) {
+        OBitStream output;
+        Encoder<M> encoder;
+        for (SymbolType symbol : symbols) {
+            encoder.encode(symbol, output);
+            encoder.model.update_state(symbol);
+        }
+        if (M::HAS_STOP) {
+            encoder.encode(M::STOP_SYMBOL, output);
+        }
+        encoder.flush(output);
+        output.flush();
+        bytes.assign(output.data(), output.data() + output.size());
+    }
+    void reset() {
+        coder = Decoder<M>();
+        bitstream = IBitStream(bytes.data(), bytes.size());
+        coder.init(bitstream);
+    }
+    void run(size_t) { coder.model.update_state(coder.decode(bitstream)); }
+};
+
+
+// OBitStream::put_bits of 17 bit values
+struct PutBitsBench {
+    const std::vector<SymbolType> &symbols;
+    OBitStream bitstream;
+
+    PutBitsBench(const std::vector<SymbolType> &symbols) : symbols(symbols), bitstream(3 * symbols.size() + 64) {}
+    void reset() { bitstream.clear(); }
+    void run(size_t i) { bitstream.put_bits(symbols[i] * 97u, 17); }
+};
+
+
+// IBitStream::get_bits of 17 bit values
+struct GetBitsBench {
+    std::vector<uint8_t> bytes;
+    IBitStream bitstream;
+
+    GetBitsBench(size_t count) : bytes(3 * count + 64, 0xA5), bitstream(nullptr, 0) {}
+    void reset() { bitstream = IBitStream(bytes.data(), bytes.size()); }
+    void run(size_t) { sink = bitstream.get_bits(17); }
+};
+
+
+void benchMicro(const std::string &name, const std::vector<SymbolType> &symbols) {
+    const size_t count = symbols.size();
+    if (count == 0) {
+        return;
+    }
+    std::cout << name << " (" << count << " samples)" << std::endl;
+    std::cout << "  benchmark                        ns/sample  Msamples/s   p50 ns    p99 ns   p999 ns" << std::endl;
+
+    { UpdateStateBench<Model> b{symbols, Model()}; printMicro("Model::update_state", measure(b, count)); }
+    { SymbolLowHighBench<Model> b(symbols); printMicro("Model::symbol_low_high", measure(b, count)); }
+    { FrequencySymbolBench<Model> b(symbols); printMicro("Model::frequency_symbol", measure(b, count)); }
+    { SymbolLowHighBench<StoplessModel> b(symbols); printMicro("StoplessModel::symbol_low_high", measure(b, count)); }
+    { FrequencySymbolBench<StoplessModel> b(symbols); printMicro("StoplessModel::frequency_symbol", measure(b, count)); }
+    { EstimateBench<Model> b(symbols); printMicro("EntropyEstimator", measure(b, count)); }
+    { EncodeBench<ArithmeticEncoder, Model> b(symbols); printMicro("ArithmeticEncoder", measure(b, count)); }
+    { DecodeBench<ArithmeticEncoder, ArithmeticDecoder, Model> b(symbols); printMicro("ArithmeticDecoder", measure(b, count)); }
+    { EncodeBench<RangeEncoder, Model> b(symbols); printMicro("RangeEncoder", measure(b, count)); }
+    { DecodeBench<RangeEncoder, RangeDecoder, Model> b(symbols); printMicro("RangeDecoder", measure(b, count)); }
+    { DecodeBench<RangeEncoder, RangeDecoder, StoplessModel> b(symbols); printMicro("RangeDecoder, stopless", measure(b, count)); }
+    { PutBitsBench b(symbols); printMicro("OBitStream::put_bits(17)", measure(b, count)); }
+    { GetBitsBench b(count); printMicro("IBitStream::get_bits(17)", measure(b, count)); }
+}
+
+
+// heap memory per channel of the adaptive model after encoding, against a full copy of the tables
+void benchAdaptiveMemory(const std::vector<SymbolType> &symbols) {
+    AdaptiveModel model;
+    for (SymbolType symbol : symbols) {
+        model.update_state(symbol);
+    }
+    const size_t flat = sizeof(AdaptiveModel::Tables) + AdaptiveModel::NUM_DIST * AdaptiveModel::NUM_SYMBOLS * sizeof(uint32_t);
+    std::cout << "  adaptive tables: " << model.owned_rows() << " of " << AdaptiveModel::NUM_DIST << " rows, "
+              << std::setprecision(1) << model.row_bytes() / 1024.0 << " KiB per channel when encoding (flat copy: "
+              << flat / 1024.0 << " KiB)" << std::endl;
+}
+
+
+void benchModels(const std::string &name, const std::vector<SymbolType> &symbols) {
+    std::cout << name << " (" << symbols.size() << " samples)" << std::endl;
+    std::cout << "  model        ratio   update ns  encode ns  decode ns  (per sample)" << std::endl;
+    benchModel<Model>("float", symbols);
+    benchModel<FixedPointModel>("fixed", symbols);
+    benchModel<AdaptiveModel>("adaptive", symbols);
+    benchAdaptiveMemory(symbols);
+}
+
+
+int main(int argc, char* argv[]) {
+    bool micro = true;
+    bool models = true;
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--micro") {
+            models = false;
+        } else if (arg == "--models") {
+            micro = false;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Usage: " << argv[0] << " [--micro | --models] [file.wav ...]" << std::endl;
+            return EXIT_FAILURE;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    std::vector<std::pair<std::string, std::vector<SymbolType>>> recordings;
+    recordings.emplace_back("synthetic", syntheticSymbols(1 << 22));
+    for (const std::string &path : paths) {
+        recordings.emplace_back(path, readSymbols(path));
+    }
+
+    std::cout << "span conversion kernels: " << neuralink_simd_name(neuralink_simd()) << std::endl;
+    for (const auto &recording : recordings) {
+        if (micro) {
+            benchMicro(recording.first, recording.second);
+        }
+        if (models) {
+            benchModels(recording.first, recording.second);
+        }
+    }
+    return EXIT_SUCCESS;
+}
@@ -16,70 +16,387 @@
 #ifndef BITSTREAM_HPP
 #define BITSTREAM_HPP
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
+#include <utility>
+#include <vector>
+#include "checkpoint.hpp"
 
+
+// Default size of the user-space block buffer between a bitstream and its std::stream.
+static constexpr size_t BITSTREAM_BUFFER_SIZE = 1 << 16; // 64 KiB
+
+
+/**
+ * @brief Bit reader that keeps up to 64 bits in a word and refills it from a block buffer.
+ *
+ * The underlying std::istream is only touched once per block, the bits are consumed from
+ * the 64-bit accumulator. Reading beyond the end of the stream yields zero bits.
+ */
 class IBitStream {
 public:
-    explicit IBitStream(std::istream& input)
-        : inputStream(input), inputBuffer(0), inputBufferPos(8) {}
+    /**
+     * @brief Constructs a bit reader on top of an input stream.
+     *
+     * @param input The input stream to read bytes from.
+     * @param bufferSize Number of bytes requested from the input stream per read. A small
+     *        buffer (e.g. 1) lowers latency on interactive pipes at the cost of throughput.
+     */
+    explicit IBitStream(std::istream& input, size_t bufferSize = BITSTREAM_BUFFER_SIZE)
+        : inputStream(&input), inputBuffer(bufferSize > 0 ? bufferSize : 1),
+          inputNext(nullptr), inputEnd(nullptr), bits(0), bitCount(0) {}
 
+    /**
+     * @brief Constructs a bit reader on a block of memory, which must outlive the reader.
+     *
+     * @param data The bytes to read.
+     * @param size The number of bytes.
+     */
+    IBitStream(const uint8_t* data, size_t size)
+        : inputStream(nullptr), inputNext(data), inputEnd(data + size), bits(0), bitCount(0) {}
+
+    IBitStream(IBitStream&&) = default;
+    IBitStream& operator=(IBitStream&&) = default;
+    IBitStream(const IBitStream&) = delete;
+    IBitStream& operator=(const IBitStream&) = delete;
+
+    /**
+     * @brief Reads a single bit.
+     *
+     * @param bit Receives the bit, or 0 when the end of the stream was reached.
+     * @return Returns `false` if the end of the stream was reached.
+     */
     bool get(bool &bit) {
-        if (inputBufferPos == 8) {
-            if (!fillInputBuffer()) {
-                return false; // End of stream or error
-            }
+        if (bitCount == 0 && !refill()) {
+            bit = 0;
+            return false; // End of stream or error
         }
-        bit = (inputBuffer >> (7 - inputBufferPos)) & 1;
-        inputBufferPos++;
+        bitCount--;
+        bit = (bits >> bitCount) & 1;
         return true;
     }
 
+    /**
+     * @brief Reads `nbits` bits, most significant bit first.
+     *
+     * @param nbits The number of bits to read, in the range [0, 32].
+     * @return The bits read, right aligned. Missing bits beyond the end of the stream are zero.
+     */
+    uint32_t get_bits(int nbits) {
+        if (bitCount < nbits) {
+            refill();
+            if (bitCount < nbits) {
+                // End of stream: pad with zero bits
+                bits <<= (nbits - bitCount);
+                bitCount = nbits;
+            }
+        }
+        bitCount -= nbits;
+        return static_cast<uint32_t>((bits >> bitCount) & low_mask(nbits));
+    }
+
+    /**
+     * @brief The number of bits that can be read before the end of the current input.
+     */
+    size_t available_bits() const {
+        return bitCount + 8 * static_cast<size_t>(inputEnd - inputNext);
+    }
+
+    /**
+     * @brief The number of bytes of the current memory input that are not yet in the accumulator.
+     */
+    size_t unread_bytes() const {
+        return static_cast<size_t>(inputEnd - inputNext);
+    }
+
+    /**
+     * @brief Continues a memory bit reader on a new block of memory.
+     *
+     * Bits already in the accumulator are read first, unread bytes of the previous block are
+     * dropped. Call absorb() first to keep them.
+     *
+     * @param data The bytes to read, which must outlive their use by the reader.
+     * @param size The number of bytes.
+     */
+    void feed(const uint8_t* data, size_t size) {
+        inputNext = data;
+        inputEnd = data + size;
+    }
+
+    /**
+     * @brief Moves the unread bytes of the current memory input into the accumulator.
+     *
+     * This detaches the reader from the memory block, so the block can be released. At most
+     * 64 bits can be held, see available_bits().
+     *
+     * @throws std::logic_error if the bits do not fit in the accumulator.
+     */
+    void absorb() {
+        if (available_bits() > 64) {
+            throw std::logic_error("Too many unread bits to absorb");
+        }
+        while (inputNext != inputEnd) {
+            bits = (bits << 8) | *inputNext++;
+            bitCount += 8;
+        }
+        inputNext = inputEnd = nullptr;
+    }
+
+    /**
+     * @brief Saves the bits in the accumulator and the unread bytes of the current input.
+     */
+    void save(CheckpointWriter &writer) const {
+        writer.put(bitCount, 1);
+        writer.put(bits, 8);
+        writer.put(unread_bytes(), 8);
+        writer.put_bytes(inputNext, unread_bytes());
+    }
+
+    /**
+     * @brief Restores the saved bits. The saved unread bytes are read first, then the input
+     *        stream, or the memory blocks passed to feed().
+     */
+    void restore(CheckpointReader &reader) {
+        bitCount = static_cast<int>(reader.get(1));
+        bits = reader.get(8);
+        const size_t count = reader.get(8);
+        if (bitCount > 64 || count > reader.remaining()) {
+            throw std::runtime_error("Invalid bit stream checkpoint");
+        }
+        inputBuffer.resize(std::max(inputBuffer.size(), count));
+        reader.get_bytes(inputBuffer.data(), count);
+        inputNext = inputBuffer.data();
+        inputEnd = inputNext + count;
+    }
+
 private:
-    std::istream& inputStream;
-    unsigned char inputBuffer;
-    int inputBufferPos;
+    std::istream* inputStream;  // nullptr when reading from memory
+    std::vector<uint8_t> inputBuffer;
+    const uint8_t* inputNext;
+    const uint8_t* inputEnd;
+    uint64_t bits;  // the lowest bitCount bits are unread
+    int bitCount;
+
+    static uint64_t low_mask(int nbits) {
+        return (static_cast<uint64_t>(1) << nbits) - 1;
+    }
+
+    // top the accumulator up to at least 57 bits, returns false if no bits are left
+    bool refill() {
+        while (bitCount <= 56) {
+            if (inputNext == inputEnd && !fillInputBuffer()) {
+                break;
+            }
+            bits = (bits << 8) | *inputNext++;
+            bitCount += 8;
+        }
+        return bitCount > 0;
+    }
 
     bool fillInputBuffer() {
-        inputBuffer = 0;
-        if (inputStream.read(reinterpret_cast<char*>(&inputBuffer), 1)) {
-            inputBufferPos = 0;
-            return true;
-        } else {
+        if (!inputStream) {
             return false;
         }
+        inputStream->read(reinterpret_cast<char*>(inputBuffer.data()), inputBuffer.size());
+        size_t count = static_cast<size_t>(inputStream->gcount());
+        inputNext = inputBuffer.data();
+        inputEnd = inputNext + count;
+        return count > 0;
     }
 };
 
+
+/**
+ * @brief Bit writer that accumulates bits in a 64-bit word and bytes in a block buffer.
+ *
+ * Complete bytes are collected in a user-space buffer that is written to the std::ostream
+ * when it is full, or on flush(). Without an output stream all bytes are kept in memory.
+ */
 class OBitStream {
 public:
-    explicit OBitStream(std::ostream& output)
-        : outputStream(output), outputBuffer(0), outputBufferPos(0) {}
+    /**
+     * @brief Constructs a bit writer on top of an output stream.
+     *
+     * @param output The output stream to write bytes to.
+     * @param bufferSize Number of bytes collected before they are written to the output stream.
+     */
+    explicit OBitStream(std::ostream& output, size_t bufferSize = BITSTREAM_BUFFER_SIZE)
+        : outputStream(&output), outputBuffer(bufferSize > 0 ? bufferSize : 1),
+          outputBufferPos(0), bits(0), bitCount(0) {}
+
+    /**
+     * @brief Constructs a bit writer that keeps the bytes in a growing memory buffer.
+     *
+     * @param initialSize The initial size of the memory buffer.
+     */
+    explicit OBitStream(size_t initialSize = 256)
+        : outputStream(nullptr), outputBuffer(initialSize > 0 ? initialSize : 1),
+          outputBufferPos(0), bits(0), bitCount(0) {}
+
+    OBitStream(OBitStream&& other)
+        : outputStream(other.outputStream), outputBuffer(std::move(other.outputBuffer)),
+          outputBufferPos(other.outputBufferPos), bits(other.bits), bitCount(other.bitCount) {
+        other.outputStream = nullptr;
+        other.outputBufferPos = 0;
+        other.bitCount = 0;
+    }
+    OBitStream(const OBitStream&) = delete;
+    OBitStream& operator=(const OBitStream&) = delete;
 
     ~OBitStream() {
-        flush();
+        if (outputStream) {
+            flush();
+        }
     }
 
     void put(bool bit) {
-        outputBuffer = (outputBuffer << 1) | bit;
-        outputBufferPos++;
-        if (outputBufferPos == 8) {
-            flush();
+        put_bits(bit, 1);
+    }
+
+    /**
+     * @brief Writes the lowest `nbits` bits of `value`, most significant bit first.
+     *
+     * @param value The bits to write, right aligned. Bits above `nbits` are ignored.
+     * @param nbits The number of bits to write, in the range [0, 32].
+     */
+    void put_bits(uint32_t value, int nbits) {
+        if (bitCount + nbits > 64) {
+            spill();
         }
+        bits = (bits << nbits) | (value & low_mask(nbits));
+        bitCount += nbits;
     }
 
+    /**
+     * @brief Pads the last incomplete byte with zero bits and writes all buffered bytes.
+     */
     void flush() {
-        if (outputBufferPos > 0) {
-            outputBuffer <<= (8 - outputBufferPos); // Align bits to the left
-            outputStream.write(reinterpret_cast<char*>(&outputBuffer), 1);
-            outputBuffer = 0;
-            outputBufferPos = 0;
+        spill();
+        if (bitCount > 0) {
+            // Align bits to the left
+            putByte(static_cast<uint8_t>(bits << (8 - bitCount)));
+            bitCount = 0;
         }
+        writeBuffer();
     }
+
+    /**
+     * @brief The bytes of a memory bit writer, the last partial byte is only included after flush().
+     */
+    const uint8_t* data() const {
+        return outputBuffer.data();
+    }
+
+    size_t size() const {
+        return outputBufferPos;
+    }
+
+    /**
+     * @brief Moves complete bytes out of a memory bit writer.
+     *
+     * Bits of an incomplete byte stay in the writer. Bytes that do not fit in `capacity` are
+     * kept for the next call, no memory is allocated.
+     *
+     * @param out Receives the bytes.
+     * @param capacity The size of `out` in bytes.
+     * @return The number of bytes written to `out`.
+     */
+    size_t take(uint8_t* out, size_t capacity) {
+        spill();
+        size_t count = outputBufferPos < capacity ? outputBufferPos : capacity;
+        if (count > 0) {
+            std::memcpy(out, outputBuffer.data(), count);
+            std::memmove(outputBuffer.data(), outputBuffer.data() + count, outputBufferPos - count);
+            outputBufferPos -= count;
+        }
+        return count;
+    }
+
+    /**
+     * @brief Saves the bytes and bits that were not handed out yet, see checkpoint.hpp.
+     *
+     * A stream writer first writes its complete bytes to the output stream, so only the bits of
+     * an incomplete byte are saved. A memory writer also saves the bytes that were not taken.
+     */
+    void save(CheckpointWriter &writer) {
+        spill();
+        if (outputStream) {
+            writeBuffer();
+        }
+        writer.put(outputBufferPos, 8);
+        writer.put_bytes(outputBuffer.data(), outputBufferPos);
+        writer.put(bitCount, 1);
+        writer.put(bits & low_mask(bitCount), 1);
+    }
+
+    /**
+     * @brief Restores the saved bytes and bits, which are written before any new bits.
+     */
+    void restore(CheckpointReader &reader) {
+        const size_t count = reader.get(8);
+        if (count > reader.remaining()) {
+            throw std::runtime_error("Invalid bit stream checkpoint");
+        }
+        outputBuffer.resize(std::max(outputBuffer.size(), count + 1));
+        reader.get_bytes(outputBuffer.data(), count);
+        outputBufferPos = count;
+        bitCount = static_cast<int>(reader.get(1));
+        bits = reader.get(1);
+        if (bitCount >= 8) {
+            throw std::runtime_error("Invalid bit stream checkpoint");
+        }
+    }
+
+    /**
+     * @brief Discards all bytes and bits of a memory bit writer, keeping its buffer.
+     */
+    void clear() {
+        outputBufferPos = 0;
+        bits = 0;
+        bitCount = 0;
+    }
+
 private:
-    std::ostream& outputStream;
-    unsigned char outputBuffer;
-    int outputBufferPos;
+    std::ostream* outputStream;  // nullptr when writing to memory
+    std::vector<uint8_t> outputBuffer;
+    size_t outputBufferPos;
+    uint64_t bits;  // the lowest bitCount bits are pending
+    int bitCount;
+
+    static uint64_t low_mask(int nbits) {
+        return (static_cast<uint64_t>(1) << nbits) - 1;
+    }
+
+    // move all complete bytes from the accumulator to the block buffer
+    void spill() {
+        while (bitCount >= 8) {
+            bitCount -= 8;
+            putByte(static_cast<uint8_t>(bits >> bitCount));
+        }
+    }
+
+    void putByte(uint8_t byte) {
+        outputBuffer[outputBufferPos++] = byte;
+        if (outputBufferPos == outputBuffer.size()) {
+            writeBuffer();
+        }
+    }
+
+    void writeBuffer() {
+        if (!outputStream) {
+            // memory writer: grow when full
+            if (outputBufferPos == outputBuffer.size()) {
+                outputBuffer.resize(2 * outputBuffer.size());
+            }
+        } else if (outputBufferPos > 0) {
+            outputStream->write(reinterpret_cast<const char*>(outputBuffer.data()), outputBufferPos);
+            outputBufferPos = 0;
+        }
+    }
 };
 
-#endif
\ No newline at end of file
+#endif
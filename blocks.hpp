@@ -0,0 +1,425 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BLOCKS_HPP
+#define BLOCKS_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "bitstream.hpp"
+#include "multichannel.hpp"
+#include "threadpool.hpp"
+
+/*
+ * Block payload layout
+ *
+ * When the stream header has a non-zero block size, the recording is cut into blocks of that
+ * many frames (one sample of every channel). Every block is coded with a freshly reset model
+ * and coder, so blocks can be decoded independently, concurrently and in any order:
+ *
+ *   8 bytes per block    sample count and coded size in bytes of the block
+ *   ...                  the coded block
+ *   8 bytes              terminator, a zero sample count and size
+ *   16 bytes per block   index: first sample of the block and offset of its record,
+ *                        relative to the first block record
+ *   16 bytes             trailer: total sample count, block count and magic "NMBI"
+ *
+ * A coded block is what the payload of a stream without blocks would be for the samples of the
+ * block: a single substream terminated by a stop symbol, or the multi-channel container for
+ * recordings with more than one channel. Sample counts include all channels. Multi-byte values
+ * are little endian.
+ *
+ * Readers that can not seek decode the blocks in order up to the terminator, readers that can
+ * seek use the index to start at any block.
+ */
+
+static const char BLOCK_INDEX_MAGIC[4] = {'N', 'M', 'B', 'I'};
+static constexpr size_t BLOCK_RECORD_SIZE = 8;
+static constexpr size_t BLOCK_INDEX_ENTRY_SIZE = 16;
+static constexpr size_t BLOCK_TRAILER_SIZE = 16;
+
+
+/**
+ * @brief The position of a block, in samples of the recording and in bytes of the payload.
+ */
+struct BlockIndexEntry {
+    uint64_t first_sample;
+    uint64_t offset;
+};
+
+
+/**
+ * @brief The block index of a payload, as stored after the terminator.
+ */
+struct BlockIndex {
+    std::vector<BlockIndexEntry> entries;
+    uint64_t total_samples = 0;
+    uint64_t payload_start = 0; ///< stream position of the first block record
+
+    /**
+     * @brief Returns the number of the block that contains a sample, which must be before the end.
+     */
+    size_t find(uint64_t sample) const {
+        auto it = std::upper_bound(entries.begin(), entries.end(), sample,
+            [](uint64_t s, const BlockIndexEntry &e) { return s < e.first_sample; });
+        return static_cast<size_t>(it - entries.begin()) - 1;
+    }
+};
+
+
+/**
+ * @brief Writes a 64 bit little endian value to a byte buffer.
+ */
+inline void block_put_u64(uint8_t *bytes, uint64_t value) {
+    multichannel_put_u32(bytes, static_cast<uint32_t>(value));
+    multichannel_put_u32(bytes + 4, static_cast<uint32_t>(value >> 32));
+}
+
+
+/**
+ * @brief Reads a 64 bit little endian value from a byte buffer.
+ */
+inline uint64_t block_get_u64(const uint8_t *bytes) {
+    return multichannel_get_u32(bytes) | (static_cast<uint64_t>(multichannel_get_u32(bytes + 4)) << 32);
+}
+
+
+/**
+ * @brief Codes a block of interleaved symbols with a fresh model and coder.
+ *
+ * @param symbols The interleaved symbols of the block, starting at channel 0.
+ * @param count The number of symbols.
+ * @param channels The number of channels.
+ * @param bytes Receives the coded block.
+ * @param model The initial model state of every channel.
+ */
+template <template <typename> class Encoder, typename M>
+void encode_block(const typename M::SymbolType *symbols, size_t count, size_t channels, std::vector<uint8_t> &bytes, const M &model = M()) {
+    static_assert(M::HAS_STOP, "Blocks end with a stop symbol");
+    bytes.clear();
+    if (channels == 1) {
+        OBitStream bitstream;
+        Encoder<M> coder;
+        coder.model = model;
+        for (size_t i = 0; i < count; ++i) {
+            coder.encode(symbols[i], bitstream);
+            coder.model.update_state(symbols[i]);
+        }
+        coder.encode(M::STOP_SYMBOL, bitstream);
+        coder.flush(bitstream);
+        bitstream.flush();
+        bytes.assign(bitstream.data(), bitstream.data() + bitstream.size());
+    } else {
+        // blocks are coded concurrently, the channels of a block are coded serially
+        ThreadPool serial(1);
+        MultiChannelEncoder<Encoder, M> encoder(channels, model);
+        encoder.encode(symbols, count, serial);
+        encoder.finish();
+        encoder.write(bytes);
+    }
+}
+
+
+/**
+ * @brief Decodes a block coded by encode_block.
+ *
+ * @param bytes The coded block.
+ * @param size The size of the coded block in bytes.
+ * @param count The number of symbols in the block.
+ * @param channels The number of channels.
+ * @param symbols Receives the `count` interleaved symbols.
+ * @param model The initial model state of every channel, the same as the one of the encoder.
+ * @throws std::runtime_error if the block does not decode to `count` symbols.
+ */
+template <template <typename> class Decoder, typename M>
+void decode_block(const uint8_t *bytes, size_t size, size_t count, size_t channels, typename M::SymbolType *symbols, const M &model = M()) {
+    static_assert(M::HAS_STOP, "Blocks end with a stop symbol");
+    size_t decoded = 0;
+    if (channels == 1) {
+        IBitStream bitstream(bytes, size);
+        Decoder<M> coder;
+        coder.model = model;
+        coder.init(bitstream);
+        decoded = coder.decode_n(bitstream, symbols, count);
+
+        // a complete block is followed by its stop symbol
+        if (decoded == count) {
+            typename M::SymbolType symbol = coder.decode(bitstream);
+            coder.model.update_state(symbol);
+            if (symbol != M::STOP_SYMBOL) {
+                throw std::runtime_error("Corrupt block");
+            }
+        }
+    } else {
+        ThreadPool serial(1);
+        MultiChannelDecoder<Decoder, M> decoder(channels, model);
+        decoder.read(bytes, size);
+        decoder.set_samples(count); // a corrupt substream must not spill past `count` symbols
+        decoded = decoder.decode(symbols, (count + channels - 1) / channels, serial);
+    }
+    if (decoded != count) {
+        throw std::runtime_error("Corrupt block");
+    }
+}
+
+
+/**
+ * @brief Cuts interleaved symbols into blocks and writes the block records, index and trailer.
+ *
+ * Symbols are collected until there is a full block for every thread of the pool, the blocks
+ * are then coded concurrently and written in order.
+ *
+ * @tparam Encoder The coder engine, ArithmeticEncoder or RangeEncoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Encoder, typename M>
+class BlockEncoder {
+    using SymbolType = typename M::SymbolType;
+    static_assert(M::HAS_STOP, "Blocks end with a stop symbol");
+
+public:
+    /**
+     * @param channels The number of interleaved channels.
+     * @param block_frames The number of frames per block.
+     * @param pool The threads that code the blocks.
+     * @param model The initial model state of every block.
+     */
+    BlockEncoder(size_t channels, size_t block_frames, ThreadPool &pool, const M &model = M())
+        : channels(channels), block_symbols(block_frames * channels), pool(pool), coded(pool.size()), model(model) {
+        if (block_symbols == 0 || block_symbols > UINT32_MAX) {
+            throw std::runtime_error("Unsupported block size");
+        }
+        pending.reserve(coded.size() * block_symbols);
+    }
+
+    /**
+     * @brief Adds interleaved symbols, the first symbol follows the last symbol of the previous call.
+     *
+     * @param outputStream The output stream that receives the completed blocks.
+     */
+    void encode(const SymbolType *symbols, size_t count, std::ostream &outputStream) {
+        const size_t batch = coded.size() * block_symbols;
+        while (count > 0) {
+            const size_t n = std::min(count, batch - pending.size());
+            pending.insert(pending.end(), symbols, symbols + n);
+            symbols += n;
+            count -= n;
+            if (pending.size() == batch) {
+                write_blocks(outputStream);
+            }
+        }
+    }
+
+    /**
+     * @brief Writes the last blocks, the terminator, the index and the trailer.
+     */
+    void finish(std::ostream &outputStream) {
+        write_blocks(outputStream);
+
+        std::vector<uint8_t> bytes(BLOCK_RECORD_SIZE + index.size() * BLOCK_INDEX_ENTRY_SIZE + BLOCK_TRAILER_SIZE, 0);
+        uint8_t *p = bytes.data() + BLOCK_RECORD_SIZE;
+        for (const BlockIndexEntry &entry : index) {
+            block_put_u64(p, entry.first_sample);
+            block_put_u64(p + 8, entry.offset);
+            p += BLOCK_INDEX_ENTRY_SIZE;
+        }
+        if (index.size() > UINT32_MAX) {
+            throw std::runtime_error("Too many blocks");
+        }
+        block_put_u64(p, samples_written);
+        multichannel_put_u32(p + 8, static_cast<uint32_t>(index.size()));
+        std::memcpy(p + 12, BLOCK_INDEX_MAGIC, 4);
+        outputStream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+
+private:
+    size_t channels;
+    size_t block_symbols;
+    ThreadPool &pool;
+    std::vector<std::vector<uint8_t>> coded;
+    M model;
+    std::vector<SymbolType> pending;
+    std::vector<BlockIndexEntry> index;
+    uint64_t samples_written = 0;
+    uint64_t bytes_written = 0;
+
+    void write_blocks(std::ostream &outputStream) {
+        const size_t num_blocks = (pending.size() + block_symbols - 1) / block_symbols;
+
+        pool.parallel_for(num_blocks, [this](size_t b) {
+            const size_t begin = b * block_symbols;
+            const size_t count = std::min(block_symbols, pending.size() - begin);
+            encode_block<Encoder, M>(pending.data() + begin, count, channels, coded[b], model);
+        });
+
+        for (size_t b = 0; b < num_blocks; ++b) {
+            const size_t count = std::min(block_symbols, pending.size() - b * block_symbols);
+            if (coded[b].size() > UINT32_MAX) {
+                throw std::runtime_error("Block too large");
+            }
+            uint8_t record[BLOCK_RECORD_SIZE];
+            multichannel_put_u32(record, static_cast<uint32_t>(count));
+            multichannel_put_u32(record + 4, static_cast<uint32_t>(coded[b].size()));
+            outputStream.write(reinterpret_cast<const char*>(record), BLOCK_RECORD_SIZE);
+            outputStream.write(reinterpret_cast<const char*>(coded[b].data()), coded[b].size());
+
+            index.push_back(BlockIndexEntry{samples_written, bytes_written});
+            samples_written += count;
+            bytes_written += BLOCK_RECORD_SIZE + coded[b].size();
+        }
+        pending.clear();
+    }
+};
+
+
+/**
+ * @brief Reads block records in order and decodes them, a batch of blocks at a time.
+ *
+ * @tparam Decoder The coder engine, ArithmeticDecoder or RangeDecoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Decoder, typename M>
+class BlockDecoder {
+    using SymbolType = typename M::SymbolType;
+    static_assert(M::HAS_STOP, "Blocks end with a stop symbol");
+
+public:
+    /**
+     * @param channels The number of interleaved channels.
+     * @param block_size The frames per block of the stream header, which bounds the block records.
+     * @param pool The threads that decode the blocks.
+     * @param model The initial model state of every block, the same as the one of the encoder.
+     */
+    BlockDecoder(size_t channels, size_t block_size, ThreadPool &pool, const M &model = M())
+        : channels(channels), max_count(static_cast<uint64_t>(block_size) * channels), pool(pool),
+          blocks(pool.size()), counts(pool.size()), model(model) {}
+
+    /**
+     * @brief Reads up to one block per thread of the pool and decodes them concurrently.
+     *
+     * @param inputStream The input stream positioned at a block record or the terminator.
+     * @param symbols Receives the interleaved symbols of the blocks.
+     * @return The number of symbols decoded, 0 after the terminator.
+     * @throws std::runtime_error if the payload is truncated or corrupt.
+     */
+    size_t decode(std::istream &inputStream, std::vector<SymbolType> &symbols) {
+        size_t num_blocks = 0;
+        while (!done && num_blocks < blocks.size()) {
+            uint8_t record[BLOCK_RECORD_SIZE];
+            if (!inputStream.read(reinterpret_cast<char*>(record), BLOCK_RECORD_SIZE)) {
+                throw std::runtime_error("Truncated block payload");
+            }
+            counts[num_blocks] = multichannel_get_u32(record);
+            if (counts[num_blocks] == 0) {
+                done = true;
+                break;
+            }
+            if (counts[num_blocks] > max_count) {
+                throw std::runtime_error("Corrupt block");
+            }
+            read_payload(inputStream, multichannel_get_u32(record + 4), blocks[num_blocks], "Truncated block payload");
+            num_blocks++;
+        }
+
+        std::vector<size_t> offsets(num_blocks + 1, 0);
+        for (size_t b = 0; b < num_blocks; ++b) {
+            offsets[b + 1] = offsets[b] + counts[b];
+        }
+        symbols.resize(offsets[num_blocks]);
+
+        pool.parallel_for(num_blocks, [&](size_t b) {
+            decode_block<Decoder, M>(blocks[b].data(), blocks[b].size(), counts[b], channels, symbols.data() + offsets[b], model);
+        });
+        return offsets[num_blocks];
+    }
+
+private:
+    size_t channels;
+    uint64_t max_count; // samples of a full block
+    ThreadPool &pool;
+    std::vector<std::vector<uint8_t>> blocks;
+    std::vector<size_t> counts;
+    M model;
+    bool done = false;
+};
+
+
+/**
+ * @brief Reads the block index from the end of a seekable stream.
+ *
+ * @param inputStream The input stream positioned at the first block record, it is left there.
+ * @return The block index.
+ * @throws std::runtime_error if the stream can not seek or has no valid index, with blocks
+ *         that start at sample 0 and increase in sample and offset within the payload.
+ */
+inline BlockIndex read_block_index(std::istream &inputStream) {
+    BlockIndex index;
+    const std::streampos start = inputStream.tellg();
+    if (start < 0 || !inputStream.seekg(0, std::ios::end)) {
+        throw std::runtime_error("Block index requires a seekable input");
+    }
+    index.payload_start = static_cast<uint64_t>(start);
+    const uint64_t end = static_cast<uint64_t>(inputStream.tellg());
+
+    uint8_t trailer[BLOCK_TRAILER_SIZE];
+    if (end < index.payload_start + BLOCK_RECORD_SIZE + BLOCK_TRAILER_SIZE
+        || !inputStream.seekg(end - BLOCK_TRAILER_SIZE)
+        || !inputStream.read(reinterpret_cast<char*>(trailer), BLOCK_TRAILER_SIZE)
+        || std::memcmp(trailer + 12, BLOCK_INDEX_MAGIC, 4) != 0) {
+        throw std::runtime_error("Missing block index");
+    }
+    index.total_samples = block_get_u64(trailer);
+    const uint64_t num_blocks = multichannel_get_u32(trailer + 8);
+
+    const uint64_t index_size = num_blocks * BLOCK_INDEX_ENTRY_SIZE;
+    if (end - BLOCK_TRAILER_SIZE - index.payload_start < index_size + BLOCK_RECORD_SIZE) {
+        throw std::runtime_error("Corrupt block index");
+    }
+    std::vector<uint8_t> bytes(index_size);
+    inputStream.seekg(end - BLOCK_TRAILER_SIZE - index_size);
+    if (!inputStream.read(reinterpret_cast<char*>(bytes.data()), bytes.size())) {
+        throw std::runtime_error("Corrupt block index");
+    }
+    index.entries.resize(num_blocks);
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        index.entries[b].first_sample = block_get_u64(&bytes[b * BLOCK_INDEX_ENTRY_SIZE]);
+        index.entries[b].offset = block_get_u64(&bytes[b * BLOCK_INDEX_ENTRY_SIZE + 8]);
+    }
+
+    // find relies on blocks that start at sample 0 and follow each other, and the records must
+    // come before the terminator
+    const uint64_t records_size = end - BLOCK_TRAILER_SIZE - index_size - BLOCK_RECORD_SIZE - index.payload_start;
+    if ((num_blocks == 0) != (index.total_samples == 0)) {
+        throw std::runtime_error("Corrupt block index");
+    }
+    for (uint64_t b = 0; b < num_blocks; ++b) {
+        const BlockIndexEntry &entry = index.entries[b];
+        const bool ordered = b == 0 ? entry.first_sample == 0 && entry.offset == 0
+            : entry.first_sample > index.entries[b - 1].first_sample && entry.offset > index.entries[b - 1].offset;
+        if (!ordered || entry.first_sample >= index.total_samples || entry.offset >= records_size
+            || records_size - entry.offset < BLOCK_RECORD_SIZE) {
+            throw std::runtime_error("Corrupt block index");
+        }
+    }
+
+    inputStream.seekg(start);
+    return index;
+}
+
+#endif
@@ -0,0 +1,335 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef BRAINWIRE_HPP
+#define BRAINWIRE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "wav.hpp"
+
+/*
+ * The .brainwire file layout
+ *
+ * Version 0 (legacy) files are the 44 byte WAV header of the recording followed by the
+ * arithmetic coded bitstream.
+ *
+ * Version 1 and later files start with a stream header describing how the payload was coded:
+ *
+ *   offset  size  field
+ *   0       4     magic "NMBW"
+ *   4       1     format version
+ *   5       2     header size in bytes, including the magic
+ *   7       4     required features, a mask of BRAINWIRE_FEATURE_* bits
+ *   11      1     coder, see BrainwireCoder
+ *   12      1     frequency bits K of a 2^K frequency total, 0 for the original 2^15 - 1 total
+ *   13      4     frames per independently coded block, 0 for a single stream, see blocks.hpp
+ *   17      1     model, see BrainwireModel
+ *   18      2     samples per separately flushed packet, 0 for a single stream, see packets.hpp
+ *   20      1     number P of stored model parameters, 0 for the default ModelParameters
+ *   21      8P    the model parameters as IEEE-754 doubles, in the order of ModelParameters::values()
+ *   21+8P   1     interleaved lanes of a mono recording, 0 for a single stream, see lanes.hpp
+ *   22+8P   2     number Q of cross-channel predictions, 0 for none, see archive.hpp
+ *   24+8P   6Q    the predictions as (target u16, source u16, coefficient i16) in prediction
+ *                 order
+ *   24+8P+6Q  1   bits per symbol of the model layout, 10 for the Neuralink data, see ModelLayout
+ *   25+8P+6Q  1   number of conditional distributions of the model layout, 4 by default
+ *   26+8P+6Q  1   1 if the substreams end with a stop symbol, 0 if their length follows from
+ *                 the data size of the WAV header and the alphabet has no stop symbol
+ *
+ * followed by the 44 byte WAV header and the coded payload. Multi-byte values are little
+ * endian. New fields are appended to the stream header; readers use the default value for
+ * fields beyond the stored header size. A new field whose non-default value changes how the
+ * payload is parsed also gets a bit of the required features, which the writer sets when the
+ * field is not at its default. Readers reject files with a bit they do not know, instead of
+ * decoding them as something else. A change of the layout or meaning of an existing field
+ * bumps the format version.
+ */
+
+static constexpr uint8_t BRAINWIRE_VERSION = 1;
+static const char BRAINWIRE_MAGIC[4] = {'N', 'M', 'B', 'W'};
+
+// the bits of the required features of a stream header, set for fields not at their default
+static constexpr uint32_t BRAINWIRE_FEATURE_FREQUENCY_BITS = 1 << 0; // a 2^K frequency total
+static constexpr uint32_t BRAINWIRE_FEATURE_BLOCKS = 1 << 1;         // independently coded blocks
+static constexpr uint32_t BRAINWIRE_FEATURE_MODEL = 1 << 2;          // a model other than BasicModel
+static constexpr uint32_t BRAINWIRE_FEATURE_PACKETS = 1 << 3;        // separately flushed packets
+static constexpr uint32_t BRAINWIRE_FEATURE_PARAMETERS = 1 << 4;     // stored model parameters
+static constexpr uint32_t BRAINWIRE_FEATURE_LANES = 1 << 5;          // interleaved lanes
+static constexpr uint32_t BRAINWIRE_FEATURE_PREDICTIONS = 1 << 6;    // cross-channel predictions
+static constexpr uint32_t BRAINWIRE_FEATURE_LAYOUT = 1 << 7;         // a non-default model layout
+static constexpr uint32_t BRAINWIRE_FEATURE_STOPLESS = 1 << 8;       // substreams without a stop symbol
+
+// the features this reader understands
+static constexpr uint32_t BRAINWIRE_KNOWN_FEATURES = (1u << 9) - 1;
+
+
+/**
+ * @brief The entropy coder engine used for the payload.
+ */
+enum class BrainwireCoder : uint8_t {
+    Arithmetic = 0, ///< bitwise ArithmeticEncoder
+    Range = 1       ///< byte-oriented RangeEncoder
+};
+
+
+/**
+ * @brief The arithmetic of the model state update.
+ */
+enum class BrainwireModel : uint8_t {
+    FloatingPoint = 0, ///< BasicModel
+    FixedPoint = 1,    ///< BasicFixedPointModel
+    Adaptive = 2       ///< BasicAdaptiveModel
+};
+
+
+/**
+ * @brief A term of the cross-channel prediction of archive mode, see archive.hpp.
+ */
+struct BrainwirePrediction {
+    uint16_t target = 0;     ///< the predicted channel
+    uint16_t source = 0;     ///< the predicting channel, lower than the target
+    int16_t coefficient = 0; ///< the weight of the change of the source, in 1/256 units
+};
+
+
+struct BrainwireHeader {
+    uint8_t version = 0;
+    BrainwireCoder coder = BrainwireCoder::Arithmetic;
+    uint8_t frequency_bits = 0;
+    uint32_t block_size = 0;
+    BrainwireModel model = BrainwireModel::FloatingPoint;
+    uint16_t packet_size = 0;
+    std::vector<double> model_parameters; ///< fitted parameters, empty for the defaults
+    uint8_t lanes = 0;
+    std::vector<BrainwirePrediction> predictions; ///< cross-channel predictions, empty for none
+    uint8_t symbol_bits = 10;  ///< bits per symbol of the model layout
+    uint8_t distributions = 4; ///< conditional distributions of the model layout
+    bool stop_symbol = true;   ///< substreams end with a stop symbol, else at the WAV data size
+    std::vector<uint8_t> wav_header;
+};
+
+
+/**
+ * @brief The required features of a header, one bit for every field that is not at its default.
+ */
+inline uint32_t brainwire_required_features(const BrainwireHeader &header) {
+    uint32_t features = 0;
+    features |= header.frequency_bits != 0 ? BRAINWIRE_FEATURE_FREQUENCY_BITS : 0u;
+    features |= header.block_size > 0 ? BRAINWIRE_FEATURE_BLOCKS : 0u;
+    features |= header.model != BrainwireModel::FloatingPoint ? BRAINWIRE_FEATURE_MODEL : 0u;
+    features |= header.packet_size > 0 ? BRAINWIRE_FEATURE_PACKETS : 0u;
+    features |= !header.model_parameters.empty() ? BRAINWIRE_FEATURE_PARAMETERS : 0u;
+    features |= header.lanes > 0 ? BRAINWIRE_FEATURE_LANES : 0u;
+    features |= !header.predictions.empty() ? BRAINWIRE_FEATURE_PREDICTIONS : 0u;
+    features |= header.symbol_bits != 10 || header.distributions != 4 ? BRAINWIRE_FEATURE_LAYOUT : 0u;
+    features |= !header.stop_symbol ? BRAINWIRE_FEATURE_STOPLESS : 0u;
+    return features;
+}
+
+
+/**
+ * @brief Appends `size` bytes of a value in little endian order.
+ */
+inline void brainwire_put_field(std::vector<uint8_t> &bytes, uint64_t value, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+
+/**
+ * @brief Reads `size` little endian bytes at `pos`, or keeps the default if the field is absent.
+ */
+template <typename U>
+void brainwire_get_field(const std::vector<uint8_t> &bytes, size_t &pos, U &value, size_t size) {
+    if (pos + size <= bytes.size()) {
+        uint64_t v = 0;
+        for (size_t i = 0; i < size; ++i) {
+            v |= static_cast<uint64_t>(bytes[pos + i]) << (8 * i);
+        }
+        value = static_cast<U>(v);
+    }
+    pos += size;
+}
+
+
+/**
+ * @brief Writes the stream header, if any, and the WAV header of a .brainwire file.
+ *
+ * @param outputStream The output stream to write to.
+ * @param header The header to write. Version 0 headers only write the WAV header.
+ * @return Returns a reference to the output stream after the write operation.
+ */
+inline std::ostream &write_brainwire_header(std::ostream &outputStream, const BrainwireHeader &header) {
+    if (header.version > 0) {
+        std::vector<uint8_t> bytes(BRAINWIRE_MAGIC, BRAINWIRE_MAGIC + 4);
+        brainwire_put_field(bytes, header.version, 1);
+        brainwire_put_field(bytes, 0, 2); // header size, filled in below
+        brainwire_put_field(bytes, brainwire_required_features(header), 4);
+        brainwire_put_field(bytes, static_cast<uint8_t>(header.coder), 1);
+        brainwire_put_field(bytes, header.frequency_bits, 1);
+        brainwire_put_field(bytes, header.block_size, 4);
+        brainwire_put_field(bytes, static_cast<uint8_t>(header.model), 1);
+        brainwire_put_field(bytes, header.packet_size, 2);
+        if (header.model_parameters.size() > 255) {
+            throw std::runtime_error("Too many model parameters");
+        }
+        brainwire_put_field(bytes, header.model_parameters.size(), 1);
+        for (double value : header.model_parameters) {
+            uint64_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            brainwire_put_field(bytes, bits, 8);
+        }
+        brainwire_put_field(bytes, header.lanes, 1);
+        if (header.predictions.size() > 0xFFFF) {
+            throw std::runtime_error("Too many cross-channel predictions");
+        }
+        brainwire_put_field(bytes, header.predictions.size(), 2);
+        for (const BrainwirePrediction &prediction : header.predictions) {
+            brainwire_put_field(bytes, prediction.target, 2);
+            brainwire_put_field(bytes, prediction.source, 2);
+            brainwire_put_field(bytes, static_cast<uint16_t>(prediction.coefficient), 2);
+        }
+        brainwire_put_field(bytes, header.symbol_bits, 1);
+        brainwire_put_field(bytes, header.distributions, 1);
+        brainwire_put_field(bytes, header.stop_symbol ? 1 : 0, 1);
+        if (bytes.size() > 0xFFFF) {
+            throw std::runtime_error("Brainwire header too large");
+        }
+
+        bytes[5] = static_cast<uint8_t>(bytes.size());
+        bytes[6] = static_cast<uint8_t>(bytes.size() >> 8);
+        outputStream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    return write_wav_header(outputStream, header.wav_header);
+}
+
+
+/**
+ * @brief Reads the stream header and the WAV header of a .brainwire file.
+ *
+ * Files that start with a WAV header instead of the stream header magic are legacy version 0
+ * files.
+ *
+ * @param inputStream The input stream to read from.
+ * @return The header, with default values for fields that are not present in the file.
+ * @throws std::runtime_error if the header is truncated, of an unsupported version, or
+ *         requires a feature this reader does not know.
+ */
+inline BrainwireHeader read_brainwire_header(std::istream &inputStream) {
+    BrainwireHeader header;
+
+    uint8_t magic[4] = {0, 0, 0, 0};
+    if (!inputStream.read(reinterpret_cast<char*>(magic), 4)) {
+        throw std::runtime_error("Truncated brainwire header");
+    }
+
+    if (std::memcmp(magic, BRAINWIRE_MAGIC, 4) != 0) {
+        // legacy file: the magic is the start of the WAV header
+        header.wav_header.assign(magic, magic + 4);
+        header.wav_header.resize(44);
+        if (!inputStream.read(reinterpret_cast<char*>(header.wav_header.data() + 4), 40)) {
+            throw std::runtime_error("Invalid WAV header size");
+        }
+        return header;
+    }
+
+    uint8_t prefix[3];
+    if (!inputStream.read(reinterpret_cast<char*>(prefix), 3)) {
+        throw std::runtime_error("Truncated brainwire header");
+    }
+    header.version = prefix[0];
+    if (header.version == 0 || header.version > BRAINWIRE_VERSION) {
+        throw std::runtime_error("Unsupported brainwire format version");
+    }
+    size_t header_size = prefix[1] | (prefix[2] << 8);
+    if (header_size < 11) {
+        throw std::runtime_error("Invalid brainwire header size");
+    }
+
+    std::vector<uint8_t> fields(header_size - 7);
+    if (!inputStream.read(reinterpret_cast<char*>(fields.data()), fields.size())) {
+        throw std::runtime_error("Truncated brainwire header");
+    }
+
+    size_t pos = 0;
+    uint32_t features = 0;
+    brainwire_get_field(fields, pos, features, 4);
+    if ((features & ~BRAINWIRE_KNOWN_FEATURES) != 0) {
+        throw std::runtime_error("Unsupported brainwire features");
+    }
+    uint8_t coder = 0;
+    brainwire_get_field(fields, pos, coder, 1);
+    brainwire_get_field(fields, pos, header.frequency_bits, 1);
+    brainwire_get_field(fields, pos, header.block_size, 4);
+    uint8_t model = 0;
+    brainwire_get_field(fields, pos, model, 1);
+    brainwire_get_field(fields, pos, header.packet_size, 2);
+    uint8_t num_parameters = 0;
+    brainwire_get_field(fields, pos, num_parameters, 1);
+    for (size_t i = 0; i < num_parameters; ++i) {
+        uint64_t bits = 0;
+        brainwire_get_field(fields, pos, bits, 8);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        header.model_parameters.push_back(value);
+    }
+    if (pos > fields.size() && num_parameters > 0) {
+        throw std::runtime_error("Truncated brainwire header");
+    }
+    brainwire_get_field(fields, pos, header.lanes, 1);
+    uint16_t num_predictions = 0;
+    brainwire_get_field(fields, pos, num_predictions, 2);
+    for (size_t i = 0; i < num_predictions; ++i) {
+        BrainwirePrediction prediction;
+        uint16_t coefficient = 0;
+        brainwire_get_field(fields, pos, prediction.target, 2);
+        brainwire_get_field(fields, pos, prediction.source, 2);
+        brainwire_get_field(fields, pos, coefficient, 2);
+        prediction.coefficient = static_cast<int16_t>(coefficient);
+        header.predictions.push_back(prediction);
+    }
+    if (pos > fields.size() && num_predictions > 0) {
+        throw std::runtime_error("Truncated brainwire header");
+    }
+    brainwire_get_field(fields, pos, header.symbol_bits, 1);
+    brainwire_get_field(fields, pos, header.distributions, 1);
+    uint8_t stop_symbol = 1;
+    brainwire_get_field(fields, pos, stop_symbol, 1);
+    header.stop_symbol = stop_symbol != 0;
+
+    if (coder > static_cast<uint8_t>(BrainwireCoder::Range)) {
+        throw std::runtime_error("Unsupported brainwire coder");
+    }
+    header.coder = static_cast<BrainwireCoder>(coder);
+
+    if (model > static_cast<uint8_t>(BrainwireModel::Adaptive)) {
+        throw std::runtime_error("Unsupported brainwire model");
+    }
+    header.model = static_cast<BrainwireModel>(model);
+
+    if (features != brainwire_required_features(header)) {
+        throw std::runtime_error("Corrupt brainwire header");
+    }
+
+    header.wav_header = read_wav_header(inputStream);
+    return header;
+}
+
+#endif
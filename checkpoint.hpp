@@ -0,0 +1,133 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+/*
+ * Checkpoints of the coder state
+ *
+ * The models, coders and bit streams save their dynamic state to a CheckpointWriter and
+ * restore it from a CheckpointReader, so that a stream can be continued bit-exactly by another
+ * process. Parameters and tables are not part of a checkpoint, the state is restored into an
+ * object constructed with the same parameters, which the stream header records. Values are
+ * stored little endian in the order they are saved, see StreamEncoder::checkpoint for the
+ * layout of a complete checkpoint.
+ */
+
+static const char CHECKPOINT_MAGIC[4] = {'N', 'M', 'C', 'K'};
+static constexpr uint8_t CHECKPOINT_VERSION = 1;
+
+
+/**
+ * @brief Collects the saved state in a byte buffer.
+ */
+class CheckpointWriter {
+public:
+    /**
+     * @brief Appends the lowest `size` bytes of a value.
+     */
+    void put(uint64_t value, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            buffer.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void put_double(double value) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        put(bits, 8);
+    }
+
+    void put_bytes(const uint8_t *data, size_t size) {
+        buffer.insert(buffer.end(), data, data + size);
+    }
+
+    const std::vector<uint8_t> &bytes() const {
+        return buffer;
+    }
+
+private:
+    std::vector<uint8_t> buffer;
+};
+
+
+/**
+ * @brief Reads the state saved by a CheckpointWriter.
+ */
+class CheckpointReader {
+public:
+    /**
+     * @param data The checkpoint, which must outlive the reader.
+     * @param size The size of the checkpoint in bytes.
+     */
+    CheckpointReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+    /**
+     * @brief Reads a value of `size` bytes.
+     *
+     * @throws std::runtime_error if the checkpoint is truncated.
+     */
+    uint64_t get(size_t size) {
+        require(size);
+        uint64_t value = 0;
+        for (size_t i = 0; i < size; ++i) {
+            value |= static_cast<uint64_t>(data[pos + i]) << (8 * i);
+        }
+        pos += size;
+        return value;
+    }
+
+    double get_double() {
+        const uint64_t bits = get(8);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    void get_bytes(uint8_t *out, size_t count) {
+        require(count);
+        if (count != 0) {
+            std::memcpy(out, data + pos, count);
+            pos += count;
+        }
+    }
+
+    /**
+     * @brief The number of bytes that are not read yet.
+     */
+    size_t remaining() const {
+        return size - pos;
+    }
+
+private:
+    const uint8_t *data;
+    size_t size;
+    size_t pos = 0;
+
+    void require(size_t count) const {
+        if (count > size - pos) {
+            throw std::runtime_error("Truncated checkpoint");
+        }
+    }
+};
+
+#endif
@@ -17,80 +17,558 @@
 #include <fstream>
 #include <cstdlib>
 #include <cstdint>
+#include <algorithm>
+#include <string>
+#include <memory>
+#include <vector>
 #include "wav.hpp"
 #include "neuralink.hpp"
 #include "arithmetic_coding.hpp"
+#include "range_coding.hpp"
+#include "brainwire.hpp"
+#include "multichannel.hpp"
+#include "blocks.hpp"
+#include "packets.hpp"
+#include "lanes.hpp"
+#include "archive.hpp"
+#include "batch.hpp"
+#include "stats.hpp"
+#include "mapped_file.hpp"
+#include "pipeline.hpp"
 
 
+// number of samples per bulk write of mono output
+static constexpr size_t CHUNK_SAMPLES = 1 << 16;
 
-void decodeStream(std::istream &inputStream, std::ostream &outputStream) {
+// number of frames (one sample of every channel) per bulk write of multi-channel output
+static constexpr size_t CHUNK_FRAMES = 1 << 12;
 
-    // read the WAV header from the input stream
-    auto header = read_wav_header(inputStream);
+// size of the output file buffer
+static constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 20;
 
-    // check the validity of the WAV header
-    neuralink_check_wav_header(header);
 
-    // write the WAV header to the output stream
-    write_wav_header(outputStream, header);
+struct DecodeSettings {
+    size_t channels = 1; ///< number of interleaved channels in the recording
+    size_t threads = 1;  ///< number of threads decoding channels or blocks concurrently
+    uint64_t first_frame = 0;          ///< first frame to decode, requires a block index
+    uint64_t frames = UINT64_MAX;      ///< maximum number of frames to decode
+    uint64_t skip_samples = 0;         ///< samples to drop from the first decoded block
+    uint64_t max_samples = UINT64_MAX; ///< samples to write
+    bool pipelined = true;             ///< read the input and write the output on background threads
+    uint64_t samples = 0;              ///< samples of the WAV data size, the length without stop symbols
+    std::vector<CodingStats> *stats = nullptr; ///< per-channel statistics, collected with --stats
+    PhaseTimer *timer = nullptr;               ///< phase timings, collected with --stats
+};
+
+
+void endPhase(const DecodeSettings &settings, const char *name) {
+    if (settings.timer) {
+        settings.timer->end_phase(name);
+    }
+}
+
+
+template <template <typename> class Decoder, typename M>
+void decodeSymbols(std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings, const M &model) {
 
     // Create an input bitstream
     IBitStream inputBitStream(inputStream);
 
-    // main loop: process symbols from the input WAV stream
-    ArithmeticDecoder<Model> decoder;
-    Model::SymbolType symbol;
+    // main loop: decode spans of symbols and write them to the output WAV stream in bulk
+    Decoder<M> decoder;
+    decoder.model = model;
+    std::vector<typename M::SymbolType> symbols(CHUNK_SAMPLES);
+    std::vector<int16_t> samples(CHUNK_SAMPLES);
+    CodingStats *stats = settings.stats ? &settings.stats->front() : nullptr;
+    bool stopped = false;
+    uint64_t remaining = M::HAS_STOP ? UINT64_MAX : settings.samples;
     decoder.init(inputBitStream);
-    while(true) {
-        symbol = decoder.decode(inputBitStream);
-        decoder.model.update_state(symbol);
 
-        // stop symbol
-        if (symbol == Model::NUM_SYMBOLS-1)
+    while (!stopped) {
+        size_t count = 0;
+        if (stats) {
+            while (count < CHUNK_SAMPLES) {
+                if (remaining == 0) {
+                    stopped = true;
+                    break;
+                }
+                typename M::SymbolType symbol = decoder.decode(inputBitStream);
+                decoder.model.update_state(symbol);
+
+                // stop symbol
+                if (M::HAS_STOP && symbol == M::STOP_SYMBOL) {
+                    stopped = true;
+                    break;
+                }
+                remaining--;
+                symbols[count++] = symbol;
+                stats->record_decoded(decoder);
+            }
+        } else {
+            // a span ends early at the stop symbol, or at the end of a stream without one
+            const size_t span = static_cast<size_t>(std::min<uint64_t>(CHUNK_SAMPLES, remaining));
+            count = decoder.decode_n(inputBitStream, symbols.data(), span);
+            remaining -= count;
+            stopped = count < span || remaining == 0;
+        }
+
+        neuralink_symbols_to_16bit<M::SYMBOL_BITS>(symbols.data(), samples.data(), count);
+        outputStream.write(reinterpret_cast<const char*>(samples.data()), count * sizeof(int16_t));
+    }
+    endPhase(settings, "coding");
+}
+
+
+template <template <typename> class Decoder, typename M>
+void decodeChannels(std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings, const BrainwireHeader &header, const M &model) {
+
+    // read all channel substreams
+    MultiChannelDecoder<Decoder, M> decoder(settings.channels, model);
+    decoder.set_stats(settings.stats);
+    if (!M::HAS_STOP) {
+        decoder.set_samples(settings.samples);
+    }
+    decoder.read(inputStream);
+    endPhase(settings, "read");
+    ThreadPool pool(settings.threads);
+
+    // archive mode codes prediction residuals, the channels of a frame are restored in order
+    ChannelPredictor predictor(settings.channels, header.predictions);
+    const bool predicted = !header.predictions.empty();
+
+    std::vector<typename M::SymbolType> symbols(CHUNK_FRAMES * settings.channels);
+    std::vector<int16_t> samples(symbols.size());
+    size_t count;
+
+    while ((count = decoder.decode(symbols.data(), CHUNK_FRAMES, pool)) > 0) {
+        if (predicted) {
+            predictor.inverse(symbols.data(), count);
+        }
+        neuralink_symbols_to_16bit<M::SYMBOL_BITS>(symbols.data(), samples.data(), count);
+        outputStream.write(reinterpret_cast<const char*>(samples.data()), count * sizeof(int16_t));
+    }
+    endPhase(settings, "coding");
+}
+
+
+// other models update their state one channel at a time
+template <template <typename> class Decoder, typename M>
+bool decodeBatchedChannels(std::istream &, std::ostream &, const DecodeSettings &, const BrainwireHeader &, const M &) {
+    return false;
+}
+
+
+/**
+ * @brief decodeChannels with the channel states of the floating point model updated in batches.
+ *
+ * @return false, without reading the input, if the recording has too few channels per thread
+ *         to fill the SIMD lanes or if statistics are collected.
+ */
+template <template <typename> class Decoder, uint32_t TOTAL_FREQUENCY>
+bool decodeBatchedChannels(std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings, const BrainwireHeader &header, const BasicModel<TOTAL_FREQUENCY> &model) {
+    if (settings.stats || settings.channels < MODEL_BATCH_WIDTH * settings.threads) {
+        return false;
+    }
+
+    // read all channel substreams
+    MultiChannelBatchDecoder<Decoder, TOTAL_FREQUENCY> decoder(settings.channels, settings.threads, model);
+    decoder.read(inputStream);
+    endPhase(settings, "read");
+    ThreadPool pool(settings.threads);
+
+    // archive mode codes prediction residuals, the channels of a frame are restored in order
+    ChannelPredictor predictor(settings.channels, header.predictions);
+    const bool predicted = !header.predictions.empty();
+
+    std::vector<SymbolType> symbols(CHUNK_FRAMES * settings.channels);
+    std::vector<int16_t> samples(symbols.size());
+    size_t count;
+
+    while ((count = decoder.decode(symbols.data(), CHUNK_FRAMES, pool)) > 0) {
+        if (predicted) {
+            predictor.inverse(symbols.data(), count);
+        }
+        neuralink_10bit_to_16bit(symbols.data(), samples.data(), count);
+        outputStream.write(reinterpret_cast<const char*>(samples.data()), count * sizeof(int16_t));
+    }
+    endPhase(settings, "coding");
+    return true;
+}
+
+
+// blocks end with a stop symbol, they are not instantiated for models without one
+template <template <typename> class Decoder, typename M>
+void decodeBlocks(std::istream &, std::ostream &, const DecodeSettings &, const BrainwireHeader &, const M &, std::false_type) {
+    throw std::runtime_error("Blocks require a stop symbol");
+}
+
+template <template <typename> class Decoder, typename M>
+void decodeBlocks(std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings, const BrainwireHeader &header, const M &model, std::true_type) {
+
+    // decode a batch of blocks concurrently, starting at the current block record
+    ThreadPool pool(settings.threads);
+    BlockDecoder<Decoder, M> decoder(settings.channels, header.block_size, pool, model);
+
+    std::vector<typename M::SymbolType> symbols;
+    std::vector<int16_t> samples;
+    uint64_t skip = settings.skip_samples;
+    uint64_t remaining = settings.max_samples;
+    size_t count;
+
+    while (remaining > 0 && (count = decoder.decode(inputStream, symbols)) > 0) {
+        const size_t begin = static_cast<size_t>(std::min<uint64_t>(skip, count));
+        const size_t end = begin + static_cast<size_t>(std::min<uint64_t>(remaining, count - begin));
+        skip -= begin;
+        remaining -= end - begin;
+
+        samples.resize(end - begin);
+        neuralink_symbols_to_16bit<M::SYMBOL_BITS>(symbols.data() + begin, samples.data(), end - begin);
+        outputStream.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(int16_t));
+    }
+}
+
+
+template <template <typename> class Decoder, typename M>
+void decodePackets(std::istream &inputStream, std::ostream &outputStream, const BrainwireHeader &header, const M &model) {
+
+    // one model for the whole stream, every packet starts a new code word
+    PacketDecoder<Decoder, M> decoder(model);
+
+    std::vector<uint8_t> packet(max_packet_bytes(header.packet_size));
+    std::vector<typename M::SymbolType> symbols(header.packet_size);
+    std::vector<int16_t> samples(header.packet_size);
+
+    while (true) {
+        uint8_t record[PACKET_RECORD_SIZE];
+        if (!inputStream.read(reinterpret_cast<char*>(record), PACKET_RECORD_SIZE)) {
+            throw std::runtime_error("Truncated packet payload");
+        }
+        const size_t count = packet_get_u16(record);
+        const size_t size = packet_get_u16(record + 2);
+        if (count == 0) {
             break;
+        }
+        if (count > header.packet_size || size > packet.size()) {
+            throw std::runtime_error("Corrupt packet");
+        }
+        if (!inputStream.read(reinterpret_cast<char*>(packet.data()), size)) {
+            throw std::runtime_error("Truncated packet payload");
+        }
 
-        // write to output file
-        neuralink_write_symbol_to_stream(outputStream, symbol);
+        decoder.decode(packet.data(), size, count, symbols.data());
+        neuralink_symbols_to_16bit<M::SYMBOL_BITS>(symbols.data(), samples.data(), count);
+        outputStream.write(reinterpret_cast<const char*>(samples.data()), count * sizeof(int16_t));
     }
 }
 
 
-int main(int argc, char* argv[]) {
+template <template <typename> class Decoder, typename M>
+void decodeLanes(std::istream &inputStream, std::ostream &outputStream, const BrainwireHeader &header, const M &model) {
+
+    // all lanes are decoded together, into the whole recording
+    LaneDecoder<Decoder, M> decoder(header.lanes, model);
+    decoder.read(inputStream, get_wav_data_size(header.wav_header) / sizeof(int16_t));
+    std::vector<typename M::SymbolType> symbols(decoder.size());
+    decoder.decode(symbols.data());
+
+    std::vector<int16_t> samples(CHUNK_SAMPLES);
+    for (size_t begin = 0; begin < symbols.size(); begin += CHUNK_SAMPLES) {
+        const size_t count = std::min(CHUNK_SAMPLES, symbols.size() - begin);
+        neuralink_symbols_to_16bit<M::SYMBOL_BITS>(symbols.data() + begin, samples.data(), count);
+        outputStream.write(reinterpret_cast<const char*>(samples.data()), count * sizeof(int16_t));
+    }
+}
+
 
-    if (argc == 3) {
-        
-        const std::string inputFilePath = argv[1];
-        const std::string outputFilePath = argv[2];
+template <template <typename> class Decoder, typename M>
+void decodePayload(std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings, const BrainwireHeader &header) {
+
+    // fitted parameters get tables of their own, the default model uses the shared tables
+    std::unique_ptr<typename M::Tables> tables;
+    M model;
+    if (!header.model_parameters.empty()) {
+        typename M::Parameters params;
+        params.set_values(header.model_parameters);
+        tables.reset(new typename M::Tables(M::make_tables(params)));
+        model = M(params, *tables);
+    }
+    endPhase(settings, "tables");
+
+    if (header.packet_size > 0) {
+        decodePackets<Decoder, M>(inputStream, outputStream, header, model);
+    } else if (header.block_size > 0) {
+        decodeBlocks<Decoder, M>(inputStream, outputStream, settings, header, model, std::integral_constant<bool, M::HAS_STOP>());
+    } else if (header.lanes > 0) {
+        decodeLanes<Decoder, M>(inputStream, outputStream, header, model);
+    } else if (settings.channels == 1) {
+        decodeSymbols<Decoder, M>(inputStream, outputStream, settings, model);
+    } else if (!decodeBatchedChannels<Decoder>(inputStream, outputStream, settings, header, model)) {
+        decodeChannels<Decoder, M>(inputStream, outputStream, settings, header, model);
+    }
+}
+
+
+// frequency totals that leave symbols of the layout without a range are not instantiated
+template <template <typename> class Decoder, typename M>
+void decodeWithTotal(std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings, const BrainwireHeader &header, std::true_type) {
+    decodePayload<Decoder, M>(inputStream, outputStream, settings, header);
+}
 
-        std::ifstream inputFile(inputFilePath, std::ios::binary);
-        if (!inputFile) {
-            std::cerr << "Error opening input file: " << inputFilePath << std::endl;
+template <template <typename> class Decoder, typename M>
+void decodeWithTotal(std::istream &, std::ostream &, const DecodeSettings &, const BrainwireHeader &, std::false_type) {
+    throw std::runtime_error("Unsupported frequency bits for the symbol bits");
+}
+
+
+template <template <typename> class Decoder, template <uint32_t, typename> class ModelFamily, typename Layout>
+void decodeWithFrequency(const BrainwireHeader &header, std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings) {
+    switch (header.frequency_bits) {
+    case 0:  decodeWithTotal<Decoder, ModelFamily<0x7FFF, Layout>>(inputStream, outputStream, settings, header, ModelSupports<0x7FFF, Layout>()); break;
+    case 12: decodeWithTotal<Decoder, ModelFamily<(1u << 12), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 12), Layout>()); break;
+    case 13: decodeWithTotal<Decoder, ModelFamily<(1u << 13), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 13), Layout>()); break;
+    case 14: decodeWithTotal<Decoder, ModelFamily<(1u << 14), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 14), Layout>()); break;
+    case 15: decodeWithTotal<Decoder, ModelFamily<(1u << 15), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 15), Layout>()); break;
+    default:
+        throw std::runtime_error("Unsupported frequency bits");
+    }
+}
+
+
+template <template <typename> class Decoder, typename Layout>
+void decodeWithModel(const BrainwireHeader &header, std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings) {
+    switch (header.model) {
+    case BrainwireModel::FloatingPoint:
+        decodeWithFrequency<Decoder, BasicModel, Layout>(header, inputStream, outputStream, settings);
+        break;
+    case BrainwireModel::FixedPoint:
+        decodeWithFrequency<Decoder, BasicFixedPointModel, Layout>(header, inputStream, outputStream, settings);
+        break;
+    case BrainwireModel::Adaptive:
+        decodeWithFrequency<Decoder, BasicAdaptiveModel, Layout>(header, inputStream, outputStream, settings);
+        break;
+    }
+}
+
+
+template <template <typename> class Decoder>
+void decodeWithLayout(const BrainwireHeader &header, std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings) {
+    if (header.distributions != NeuralinkLayout::NUM_DIST) {
+        throw std::runtime_error("Unsupported number of distributions");
+    }
+    if (!header.stop_symbol) {
+        decodeWithModel<Decoder, NeuralinkStoplessLayout>(header, inputStream, outputStream, settings);
+        return;
+    }
+    switch (header.symbol_bits) {
+    case 10: decodeWithModel<Decoder, NeuralinkLayout>(header, inputStream, outputStream, settings); break;
+    case 12: decodeWithModel<Decoder, ModelLayout<12, 4>>(header, inputStream, outputStream, settings); break;
+    default:
+        throw std::runtime_error("Unsupported symbol bits");
+    }
+}
+
+
+void decodeStream(std::istream &inputStream, std::ostream &outputStream, DecodeSettings settings) {
+
+    // read the stream header and the WAV header from the input stream
+    BrainwireHeader header = read_brainwire_header(inputStream);
+
+    // check the validity of the WAV header
+    settings.channels = neuralink_check_wav_header(header.wav_header);
+
+    if (!header.predictions.empty() && (settings.channels == 1 || header.packet_size > 0 || header.block_size > 0 || header.lanes > 0)) {
+        throw std::runtime_error("Cross-channel predictions require a multi-channel recording without blocks, packets or lanes");
+    }
+    if (!header.predictions.empty() && header.symbol_bits != NeuralinkLayout::SYMBOL_BITS) {
+        throw std::runtime_error("Cross-channel predictions require 10 bit symbols");
+    }
+    if (!header.stop_symbol && (header.packet_size > 0 || header.block_size > 0 || header.lanes > 0 || header.symbol_bits != NeuralinkLayout::SYMBOL_BITS)) {
+        throw std::runtime_error("Streams without stop symbols support 10 bit symbols without blocks, packets or lanes only");
+    }
+    settings.samples = get_wav_data_size(header.wav_header) / sizeof(int16_t);
+    if (settings.stats && (header.packet_size > 0 || header.block_size > 0 || header.lanes > 0)) {
+        throw std::runtime_error("Statistics are not available with blocks, packets or lanes");
+    }
+    if (settings.stats) {
+        settings.stats->resize(settings.channels, settings.stats->front());
+    }
+
+    // a range of frames is located with the block index and gets its own WAV header
+    if (settings.first_frame > 0 || settings.frames != UINT64_MAX) {
+        if (header.block_size == 0) {
+            throw std::runtime_error("Decoding a range of frames requires a file encoded with --block-size");
+        }
+        if (inputStream.tellg() < 0) {
+            throw std::runtime_error("Decoding a range of frames requires a seekable input file, not a pipe");
+        }
+        const BlockIndex index = read_block_index(inputStream);
+        const uint64_t total_frames = (index.total_samples + settings.channels - 1) / settings.channels;
+        const uint64_t first = std::min(settings.first_frame, total_frames);
+        const uint64_t frames = std::min(settings.frames, total_frames - first);
+
+        const uint64_t first_sample = first * settings.channels;
+        settings.max_samples = std::min(frames * settings.channels, index.total_samples - first_sample);
+        if (settings.max_samples > 0) {
+            const BlockIndexEntry &entry = index.entries[index.find(first_sample)];
+            settings.skip_samples = first_sample - entry.first_sample;
+            inputStream.seekg(static_cast<std::streamoff>(index.payload_start + entry.offset));
+        }
+        if (settings.max_samples * sizeof(int16_t) > UINT32_MAX - 36) {
+            throw std::runtime_error("Range too large for a WAV file");
+        }
+        set_wav_data_size(header.wav_header, static_cast<uint32_t>(settings.max_samples * sizeof(int16_t)));
+    }
+
+    // write the WAV header to the output stream
+    write_wav_header(outputStream, header.wav_header);
+    endPhase(settings, "header");
+
+    switch (header.coder) {
+    case BrainwireCoder::Arithmetic:
+        decodeWithLayout<ArithmeticDecoder>(header, inputStream, outputStream, settings);
+        break;
+    case BrainwireCoder::Range:
+        decodeWithLayout<RangeDecoder>(header, inputStream, outputStream, settings);
+        break;
+    }
+
+    if (settings.stats) {
+        print_stats(std::cerr, *settings.stats, *settings.timer, false);
+    }
+}
+
+
+/**
+ * @brief decodeStream with the input read ahead and the output written on background threads.
+ *
+ * A mapped input is read on the coding thread, a reader thread would only copy its pages.
+ */
+void decodePipelined(std::istream &inputStream, std::ostream &outputStream, const DecodeSettings &settings, bool mappedInput) {
+    PipelinedOutputStream pipelinedOutput(outputStream);
+
+    // a range of frames is located by seeking, the input is then read on this thread
+    if (mappedInput || settings.first_frame > 0 || settings.frames != UINT64_MAX) {
+        decodeStream(inputStream, pipelinedOutput, settings);
+    } else {
+        PipelinedInputStream pipelinedInput(inputStream);
+        decodeStream(pipelinedInput, pipelinedOutput, settings);
+    }
+    pipelinedOutput.finish();
+}
+
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] [inputFile outputFile]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --threads=N       threads decoding channels or blocks (default: number of hardware threads)" << std::endl;
+    std::cerr << "  --start=F         first frame to decode, for files encoded with --block-size" << std::endl;
+    std::cerr << "  --frames=N        number of frames to decode, for files encoded with --block-size" << std::endl;
+    std::cerr << "  --no-pipeline     read, decode and write on one thread" << std::endl;
+    std::cerr << "  --stats           print coding statistics and phase timings to stderr" << std::endl;
+    std::cerr << "  --stats-window=N  samples per point of the bits/sample timeline (default: 2^20)" << std::endl;
+}
+
+
+// the command-line tool, main reports the errors it throws
+int run(int argc, char* argv[]) {
+
+    DecodeSettings settings;
+    settings.threads = default_thread_count();
+    std::vector<std::string> paths;
+
+    // statistics, the first entry holds the options for all channels
+    std::vector<CodingStats> stats(1);
+    PhaseTimer timer;
+    bool collectStats = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.compare(0, 10, "--threads=") == 0) {
+            settings.threads = std::max(1, std::atoi(arg.c_str() + 10));
+        } else if (arg.compare(0, 8, "--start=") == 0) {
+            settings.first_frame = std::strtoull(arg.c_str() + 8, nullptr, 10);
+        } else if (arg.compare(0, 9, "--frames=") == 0) {
+            settings.frames = std::strtoull(arg.c_str() + 9, nullptr, 10);
+        } else if (arg == "--no-pipeline") {
+            settings.pipelined = false;
+        } else if (arg == "--stats") {
+            collectStats = true;
+        } else if (arg.compare(0, 15, "--stats-window=") == 0) {
+            collectStats = true;
+            stats[0].window = std::max(1L, std::atol(arg.c_str() + 15));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
             return EXIT_FAILURE;
+        } else {
+            paths.push_back(arg);
         }
+    }
 
-        // Open the output file stream
-        std::ofstream outputFile(outputFilePath, std::ios::binary);
+    if (collectStats) {
+        settings.stats = &stats;
+        settings.timer = &timer;
+    }
+
+    if (paths.size() == 2) {
+
+        const std::string inputFilePath = paths[0];
+        const std::string outputFilePath = paths[1];
+
+        // Map the input file, or read it as a regular file stream if it can not be mapped
+        MappedInputStream mappedFile(inputFilePath);
+        std::ifstream inputFile;
+        if (!mappedFile.is_open()) {
+            inputFile.open(inputFilePath, std::ios::binary);
+            if (!inputFile) {
+                std::cerr << "Error opening input file: " << inputFilePath << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::istream &input = mappedFile.is_open() ? static_cast<std::istream&>(mappedFile) : inputFile;
+
+        // Open the output file stream with a large buffer
+        std::vector<char> outputBuffer(OUTPUT_BUFFER_SIZE);
+        std::ofstream outputFile;
+        outputFile.rdbuf()->pubsetbuf(outputBuffer.data(), outputBuffer.size());
+        outputFile.open(outputFilePath, std::ios::binary);
         if (!outputFile) {
             std::cerr << "Error opening output file: " << outputFilePath << std::endl;
             return EXIT_FAILURE;
         }
 
         // Process the streams
-        decodeStream(inputFile, outputFile);
+        if (settings.pipelined) {
+            decodePipelined(input, outputFile, settings, mappedFile.is_open());
+        } else {
+            decodeStream(input, outputFile, settings);
+        }
 
         // Close the file streams
-        inputFile.close();
         outputFile.close();
 
-    } else if (argc == 1) {
+    } else if (paths.empty()) {
         // Process standard input and output streams
-        decodeStream(std::cin, std::cout);
+        if (settings.pipelined) {
+            decodePipelined(std::cin, std::cout, settings, false);
+        } else {
+            decodeStream(std::cin, std::cout, settings);
+        }
 
     } else {
-        std::cerr << "Usage: " << argv[0] << " [inputFile outputFile]" << std::endl;
+        printUsage(argv[0]);
         return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
 }
 
+
+int main(int argc, char* argv[]) {
+    try {
+        return run(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
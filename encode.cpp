@@ -14,85 +14,843 @@
  * limitations under the License.
  */
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <cstdlib>
 #include <cstdint>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iterator>
+#include <string>
+#include <memory>
+#include <vector>
 #include "wav.hpp"
 #include "neuralink.hpp"
 #include "arithmetic_coding.hpp"
+#include "range_coding.hpp"
+#include "brainwire.hpp"
+#include "multichannel.hpp"
+#include "blocks.hpp"
+#include "packets.hpp"
+#include "lanes.hpp"
+#include "archive.hpp"
+#include "batch.hpp"
+#include "stats.hpp"
+#include "mapped_file.hpp"
+#include "pipeline.hpp"
 
 
-void encodeStream(std::istream &inputStream, std::ostream &outputStream) {
+// number of samples per bulk read of mono input
+static constexpr size_t CHUNK_SAMPLES = 1 << 16;
 
-    // read the WAV header from the input stream
-    auto header = read_wav_header(inputStream);
+// number of frames (one sample of every channel) per bulk read of multi-channel input
+static constexpr size_t CHUNK_FRAMES = 1 << 12;
+
+// size of the output file buffer
+static constexpr size_t OUTPUT_BUFFER_SIZE = 1 << 20;
+
+
+struct EncodeSettings {
+    size_t channels = 1; ///< number of interleaved channels in the input
+    size_t threads = 1;  ///< number of threads coding channels or blocks concurrently
+    size_t block_size = 0; ///< frames per independently coded block, 0 for a single stream
+    size_t packet_size = 0; ///< samples per separately flushed packet, 0 for a single stream
+    size_t lanes = 0;       ///< interleaved lanes of a mono recording, 0 for a single stream
+    bool packet_report = false; ///< print the size and flush overhead of every packet
+    bool archive = false;       ///< fit cross-channel predictions on the start of the recording
+    bool pipelined = true;      ///< read the input and write the output on background threads
+    bool estimate = false;      ///< print the estimated coded sizes instead of encoding
+    uint64_t samples = 0;       ///< samples of the WAV data size, all of them without stop symbols
+    std::vector<BrainwirePrediction> predictions; ///< cross-channel predictions of the channels
+    std::vector<CodingStats> *stats = nullptr; ///< per-channel statistics, collected with --stats
+    PhaseTimer *timer = nullptr;               ///< phase timings, collected with --stats
+};
+
+
+void endPhase(const EncodeSettings &settings, const char *name) {
+    if (settings.timer) {
+        settings.timer->end_phase(name);
+    }
+}
+
+
+// a stream without stop symbols is decoded up to the data size of the WAV header
+template <typename M>
+void checkSampleCount(const EncodeSettings &settings, uint64_t samples) {
+    if (!M::HAS_STOP && samples != settings.samples) {
+        throw std::runtime_error("The samples do not match the data size of the WAV header");
+    }
+}
 
-    // check the validity of the WAV header
-    neuralink_check_wav_header(header);
 
-    // write the WAV header to the output stream
-    write_wav_header(outputStream, header);
+template <template <typename> class Encoder, typename M>
+void encodeSymbols(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const M &model) {
 
     // Create an output bitstream
     OBitStream outputBitStream(outputStream);
 
-    // main loop: process symbols from the input WAV stream
-    ArithmeticEncoder<Model> encoder;
-    Model::SymbolType symbol;
+    // main loop: process spans of symbols from the input WAV stream
+    Encoder<M> encoder;
+    encoder.model = model;
+    std::vector<int16_t> samples(CHUNK_SAMPLES);
+    std::vector<typename M::SymbolType> symbols(CHUNK_SAMPLES);
+    CodingStats *stats = settings.stats ? &settings.stats->front() : nullptr;
+    uint64_t total = 0;
+    size_t count;
 
-    while (neuralink_read_symbol_from_stream(inputStream, symbol)) {
-        encoder.encode(symbol, outputBitStream);
-        encoder.model.update_state(symbol);
+    while ((count = neuralink_read_samples_from_stream(inputStream, samples.data(), samples.size())) > 0) {
+        total += count;
+        neuralink_16bit_to_symbols<M::SYMBOL_BITS>(samples.data(), symbols.data(), count);
+        if (stats) {
+            for (size_t i = 0; i < count; ++i) {
+                encoder.encode(symbols[i], outputBitStream);
+                encoder.model.update_state(symbols[i]);
+                stats->record_encoded(encoder);
+            }
+        } else {
+            for (size_t i = 0; i < count; ++i) {
+                encoder.encode(symbols[i], outputBitStream);
+                encoder.model.update_state(symbols[i]);
+            }
+        }
     }
+    endPhase(settings, "coding");
+    checkSampleCount<M>(settings, total);
 
     // write a stop symbol
-    encoder.encode(Model::NUM_SYMBOLS-1, outputBitStream);
+    if (M::HAS_STOP) {
+        encoder.encode(M::STOP_SYMBOL, outputBitStream);
+    }
 
     // ternimate the last written symbol
     encoder.flush(outputBitStream);
 
     // terminate any incomplete byte in the  output bit buffer
     outputBitStream.flush();
+    endPhase(settings, "flush");
+}
+
+
+template <template <typename> class Encoder, typename M>
+void encodeChannels(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const M &model) {
+
+    // one model and coder per channel, each channel is coded into its own substream
+    MultiChannelEncoder<Encoder, M> encoder(settings.channels, model);
+    encoder.set_stats(settings.stats);
+    ThreadPool pool(settings.threads);
+    ChannelPredictor predictor(settings.channels, settings.predictions);
+    const bool predicted = !settings.predictions.empty();
 
+    std::vector<int16_t> samples(CHUNK_FRAMES * settings.channels);
+    std::vector<typename M::SymbolType> symbols(samples.size());
+    uint64_t total = 0;
+    size_t count;
+
+    while ((count = neuralink_read_samples_from_stream(inputStream, samples.data(), samples.size())) > 0) {
+        total += count;
+        neuralink_16bit_to_symbols<M::SYMBOL_BITS>(samples.data(), symbols.data(), count);
+        if (predicted) {
+            predictor.forward(symbols.data(), count);
+        }
+        encoder.encode(symbols.data(), count, pool);
+    }
+    endPhase(settings, "coding");
+    checkSampleCount<M>(settings, total);
+
+    // write the stop symbols and the substreams
+    encoder.finish();
+    encoder.write(outputStream);
+    endPhase(settings, "flush");
 }
 
 
-int main(int argc, char* argv[]) {
+// other models update their state one channel at a time
+template <template <typename> class Encoder, typename M>
+bool encodeBatchedChannels(std::istream &, std::ostream &, const EncodeSettings &, const M &) {
+    return false;
+}
+
+
+/**
+ * @brief encodeChannels with the channel states of the floating point model updated in batches.
+ *
+ * @return false, without reading the input, if the recording has too few channels per thread
+ *         to fill the SIMD lanes or if statistics are collected.
+ */
+template <template <typename> class Encoder, uint32_t TOTAL_FREQUENCY>
+bool encodeBatchedChannels(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const BasicModel<TOTAL_FREQUENCY> &model) {
+    if (settings.stats || settings.channels < MODEL_BATCH_WIDTH * settings.threads) {
+        return false;
+    }
+
+    MultiChannelBatchEncoder<Encoder, TOTAL_FREQUENCY> encoder(settings.channels, settings.threads, model);
+    ThreadPool pool(settings.threads);
+    ChannelPredictor predictor(settings.channels, settings.predictions);
+    const bool predicted = !settings.predictions.empty();
+
+    std::vector<int16_t> samples(CHUNK_FRAMES * settings.channels);
+    std::vector<SymbolType> symbols(samples.size());
+    size_t count;
+
+    while ((count = neuralink_read_samples_from_stream(inputStream, samples.data(), samples.size())) > 0) {
+        neuralink_16bit_to_10bit(samples.data(), symbols.data(), count);
+        if (predicted) {
+            predictor.forward(symbols.data(), count);
+        }
+        encoder.encode(symbols.data(), count, pool);
+    }
+    endPhase(settings, "coding");
+
+    // write the stop symbols and the substreams
+    encoder.finish();
+    encoder.write(outputStream);
+    endPhase(settings, "flush");
+    return true;
+}
+
+
+// blocks end with a stop symbol, they are not instantiated for models without one
+template <template <typename> class Encoder, typename M>
+void encodeBlocks(std::istream &, std::ostream &, const EncodeSettings &, const M &, std::false_type) {
+    throw std::runtime_error("Blocks require a stop symbol");
+}
+
+template <template <typename> class Encoder, typename M>
+void encodeBlocks(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const M &model, std::true_type) {
+
+    // independently coded blocks, a batch of blocks is coded concurrently
+    ThreadPool pool(settings.threads);
+    BlockEncoder<Encoder, M> encoder(settings.channels, settings.block_size, pool, model);
+
+    std::vector<int16_t> samples(CHUNK_FRAMES * settings.channels);
+    std::vector<typename M::SymbolType> symbols(samples.size());
+    size_t count;
+
+    while ((count = neuralink_read_samples_from_stream(inputStream, samples.data(), samples.size())) > 0) {
+        neuralink_16bit_to_symbols<M::SYMBOL_BITS>(samples.data(), symbols.data(), count);
+        encoder.encode(symbols.data(), count, outputStream);
+    }
+
+    // write the last blocks and the block index
+    encoder.finish(outputStream);
+}
+
+
+template <template <typename> class Encoder, typename M>
+void encodePackets(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const M &model) {
+
+    // one model for the whole stream, the coder is flushed after every packet
+    PacketEncoder<Encoder, M> encoder(model);
+
+    std::vector<int16_t> samples(settings.packet_size);
+    std::vector<typename M::SymbolType> symbols(settings.packet_size);
+    std::vector<uint8_t> packet(PACKET_RECORD_SIZE + max_packet_bytes(settings.packet_size));
+    size_t packets = 0, total_bytes = 0, total_flush_bits = 0, max_flush_bits = 0;
+    size_t count;
+
+    while ((count = neuralink_read_samples_from_stream(inputStream, samples.data(), samples.size())) > 0) {
+        neuralink_16bit_to_symbols<M::SYMBOL_BITS>(samples.data(), symbols.data(), count);
+        PacketInfo info = encoder.encode(symbols.data(), count, packet.data() + PACKET_RECORD_SIZE, packet.size() - PACKET_RECORD_SIZE);
+
+        packet_put_u16(packet.data(), static_cast<uint16_t>(info.samples));
+        packet_put_u16(packet.data() + 2, static_cast<uint16_t>(info.bytes));
+        outputStream.write(reinterpret_cast<const char*>(packet.data()), PACKET_RECORD_SIZE + info.bytes);
+
+        if (settings.packet_report) {
+            std::cerr << "packet " << packets << ": " << info.samples << " samples, " << info.bytes
+                      << " bytes, " << info.flush_bits << " flush bits" << std::endl;
+        }
+        packets++;
+        total_bytes += PACKET_RECORD_SIZE + info.bytes;
+        total_flush_bits += info.flush_bits;
+        max_flush_bits = std::max(max_flush_bits, info.flush_bits);
+    }
+
+    // terminator
+    const uint8_t terminator[PACKET_RECORD_SIZE] = {0, 0, 0, 0};
+    outputStream.write(reinterpret_cast<const char*>(terminator), PACKET_RECORD_SIZE);
+
+    if (settings.packet_report && packets > 0) {
+        std::cerr << packets << " packets, " << total_bytes << " bytes, flush overhead "
+                  << static_cast<double>(total_flush_bits) / packets << " bits per packet on average, "
+                  << max_flush_bits << " at most, plus " << 8 * PACKET_RECORD_SIZE << " bits of framing" << std::endl;
+    }
+}
+
+
+template <template <typename> class Encoder, typename M>
+void encodeLanes(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const M &model) {
+
+    // the lanes are segments of the whole recording, so it is read into memory first
+    std::vector<int16_t> samples(CHUNK_SAMPLES);
+    std::vector<typename M::SymbolType> symbols;
+    size_t count;
+
+    while ((count = neuralink_read_samples_from_stream(inputStream, samples.data(), samples.size())) > 0) {
+        symbols.resize(symbols.size() + count);
+        neuralink_16bit_to_symbols<M::SYMBOL_BITS>(samples.data(), symbols.data() + symbols.size() - count, count);
+    }
+
+    std::vector<uint8_t> bytes;
+    encode_lanes<Encoder, M>(symbols.data(), symbols.size(), settings.lanes, bytes, model);
+    outputStream.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+
+template <template <typename> class Encoder, typename M>
+void encodePayload(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const BrainwireHeader &header) {
+
+    // fitted parameters get tables of their own, the default model uses the shared tables
+    std::unique_ptr<typename M::Tables> tables;
+    M model;
+    if (!header.model_parameters.empty()) {
+        typename M::Parameters params;
+        params.set_values(header.model_parameters);
+        tables.reset(new typename M::Tables(M::make_tables(params)));
+        model = M(params, *tables);
+    }
+    endPhase(settings, "tables");
+
+    if (settings.packet_size > 0) {
+        encodePackets<Encoder, M>(inputStream, outputStream, settings, model);
+    } else if (settings.block_size > 0) {
+        encodeBlocks<Encoder, M>(inputStream, outputStream, settings, model, std::integral_constant<bool, M::HAS_STOP>());
+    } else if (settings.lanes > 0) {
+        encodeLanes<Encoder, M>(inputStream, outputStream, settings, model);
+    } else if (settings.channels == 1) {
+        encodeSymbols<Encoder, M>(inputStream, outputStream, settings, model);
+    } else if (!encodeBatchedChannels<Encoder>(inputStream, outputStream, settings, model)) {
+        encodeChannels<Encoder, M>(inputStream, outputStream, settings, model);
+    }
+}
+
+
+// frequency totals that leave symbols of the layout without a range are not instantiated
+template <template <typename> class Encoder, typename M>
+void encodeWithTotal(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const BrainwireHeader &header, std::true_type) {
+    encodePayload<Encoder, M>(inputStream, outputStream, settings, header);
+}
+
+template <template <typename> class Encoder, typename M>
+void encodeWithTotal(std::istream &, std::ostream &, const EncodeSettings &, const BrainwireHeader &, std::false_type) {
+    throw std::runtime_error("Unsupported frequency bits for the symbol bits");
+}
+
+
+template <template <typename> class Encoder, template <uint32_t, typename> class ModelFamily, typename Layout>
+void encodeWithFrequency(const BrainwireHeader &header, std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings) {
+    switch (header.frequency_bits) {
+    case 0:  encodeWithTotal<Encoder, ModelFamily<0x7FFF, Layout>>(inputStream, outputStream, settings, header, ModelSupports<0x7FFF, Layout>()); break;
+    case 12: encodeWithTotal<Encoder, ModelFamily<(1u << 12), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 12), Layout>()); break;
+    case 13: encodeWithTotal<Encoder, ModelFamily<(1u << 13), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 13), Layout>()); break;
+    case 14: encodeWithTotal<Encoder, ModelFamily<(1u << 14), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 14), Layout>()); break;
+    case 15: encodeWithTotal<Encoder, ModelFamily<(1u << 15), Layout>>(inputStream, outputStream, settings, header, ModelSupports<(1u << 15), Layout>()); break;
+    default:
+        throw std::runtime_error("Unsupported frequency bits");
+    }
+}
+
+
+template <template <typename> class Encoder, typename Layout>
+void encodeWithModel(const BrainwireHeader &header, std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings) {
+    switch (header.model) {
+    case BrainwireModel::FloatingPoint:
+        encodeWithFrequency<Encoder, BasicModel, Layout>(header, inputStream, outputStream, settings);
+        break;
+    case BrainwireModel::FixedPoint:
+        encodeWithFrequency<Encoder, BasicFixedPointModel, Layout>(header, inputStream, outputStream, settings);
+        break;
+    case BrainwireModel::Adaptive:
+        encodeWithFrequency<Encoder, BasicAdaptiveModel, Layout>(header, inputStream, outputStream, settings);
+        break;
+    }
+}
+
+
+template <template <typename> class Encoder>
+void encodeWithLayout(const BrainwireHeader &header, std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings) {
+    if (header.distributions != NeuralinkLayout::NUM_DIST) {
+        throw std::runtime_error("Unsupported number of distributions");
+    }
+    if (!header.stop_symbol) {
+        encodeWithModel<Encoder, NeuralinkStoplessLayout>(header, inputStream, outputStream, settings);
+        return;
+    }
+    switch (header.symbol_bits) {
+    case 10: encodeWithModel<Encoder, NeuralinkLayout>(header, inputStream, outputStream, settings); break;
+    case 12: encodeWithModel<Encoder, ModelLayout<12, 4>>(header, inputStream, outputStream, settings); break;
+    default:
+        throw std::runtime_error("Unsupported symbol bits");
+    }
+}
+
+
+/**
+ * @brief Fits the cross-channel predictions on the start of a recording held in memory.
+ */
+std::vector<BrainwirePrediction> fitPredictions(const std::vector<char> &prefix, const EncodeSettings &settings) {
+    MemoryStreamBuf buffer(reinterpret_cast<const uint8_t*>(prefix.data()), prefix.size());
+    std::istream prefixStream(&buffer);
+
+    std::vector<int16_t> samples(prefix.size() / sizeof(int16_t));
+    const size_t count = neuralink_read_samples_from_stream(prefixStream, samples.data(), samples.size());
+    std::vector<SymbolType> symbols(count);
+    neuralink_16bit_to_10bit(samples.data(), symbols.data(), count);
+
+    ThreadPool pool(settings.threads);
+    return fit_channel_predictions<Model>(symbols.data(), count - count % settings.channels, settings.channels, pool);
+}
+
+
+void encodeStream(std::istream &inputStream, std::ostream &outputStream, BrainwireHeader header, EncodeSettings settings) {
+
+    // read the WAV header from the input stream
+    header.wav_header = read_wav_header(inputStream);
+
+    // check the validity of the WAV header
+    settings.channels = neuralink_check_wav_header(header.wav_header);
+
+    // multi-channel recordings can not be stored in the legacy format
+    if (settings.channels > 1) {
+        header.version = BRAINWIRE_VERSION;
+    }
+    settings.block_size = header.block_size;
+    settings.packet_size = header.packet_size;
+    settings.lanes = header.lanes;
+
+    if (settings.packet_size > 0 && (settings.channels > 1 || settings.block_size > 0)) {
+        throw std::runtime_error("Packet mode supports mono recordings without blocks only");
+    }
+    if (settings.lanes > 0 && (settings.channels > 1 || settings.block_size > 0 || settings.packet_size > 0)) {
+        throw std::runtime_error("Lanes support mono recordings without blocks or packets only");
+    }
+    if (settings.archive && (settings.channels == 1 || settings.block_size > 0 || settings.packet_size > 0 || settings.lanes > 0)) {
+        throw std::runtime_error("Archive mode supports multi-channel recordings without blocks, packets or lanes only");
+    }
+    if (settings.archive && header.symbol_bits != NeuralinkLayout::SYMBOL_BITS) {
+        throw std::runtime_error("Archive mode supports 10 bit symbols only");
+    }
+    if (!header.stop_symbol && (settings.block_size > 0 || settings.packet_size > 0 || settings.lanes > 0 || header.symbol_bits != NeuralinkLayout::SYMBOL_BITS)) {
+        throw std::runtime_error("Streams without stop symbols support 10 bit symbols without blocks, packets or lanes only");
+    }
+    settings.samples = get_wav_data_size(header.wav_header) / sizeof(int16_t);
+    if (settings.stats && (settings.packet_size > 0 || settings.block_size > 0 || settings.lanes > 0)) {
+        throw std::runtime_error("Statistics are not available with blocks, packets or lanes");
+    }
+    if (settings.stats) {
+        settings.stats->resize(settings.channels, settings.stats->front());
+    }
+
+    // archive mode reads ahead the frames of the prediction fit, and then codes them followed by
+    // the rest of the input
+    std::vector<char> prefix;
+    if (settings.archive) {
+        prefix.resize(PREDICTION_FIT_FRAMES * settings.channels * sizeof(int16_t));
+        inputStream.read(prefix.data(), prefix.size());
+        prefix.resize(static_cast<size_t>(inputStream.gcount()));
+        inputStream.clear(inputStream.rdstate() & std::ios_base::badbit);
+        header.predictions = fitPredictions(prefix, settings);
+        settings.predictions = header.predictions;
+        endPhase(settings, "prediction fit");
+    }
+    PrefixStreamBuf prefixBuffer(reinterpret_cast<const uint8_t*>(prefix.data()), prefix.size(), inputStream);
+    std::istream prefixStream(&prefixBuffer);
+    std::istream &payloadStream = settings.archive ? prefixStream : inputStream;
+
+    // write the stream header and the WAV header to the output stream
+    write_brainwire_header(outputStream, header);
+    endPhase(settings, "header");
+
+    switch (header.coder) {
+    case BrainwireCoder::Arithmetic:
+        encodeWithLayout<ArithmeticEncoder>(header, payloadStream, outputStream, settings);
+        break;
+    case BrainwireCoder::Range:
+        encodeWithLayout<RangeEncoder>(header, payloadStream, outputStream, settings);
+        break;
+    }
+
+    if (settings.stats) {
+        print_stats(std::cerr, *settings.stats, *settings.timer, true);
+    }
+}
+
+
+/**
+ * @brief Prints the estimated coded size of a recording under every model, without coding it.
+ *
+ * The estimate is the cost of every symbol under the model that codes it, see EntropyEstimator,
+ * and does not depend on the coder engine. Multi-channel recordings also get the estimate of
+ * every channel in bits per sample, and the model with the smallest estimate.
+ */
+template <uint32_t TOTAL_FREQUENCY, typename Layout>
+void estimateModels(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const BrainwireHeader &header, std::true_type) {
+    using FloatModel = BasicModel<TOTAL_FREQUENCY, Layout>;
+    using FixedModel = BasicFixedPointModel<TOTAL_FREQUENCY, Layout>;
+    using AdaptiveModel = BasicAdaptiveModel<TOTAL_FREQUENCY, Layout>;
+
+    // fitted parameters get tables of their own, shared by the three models
+    BasicModelParameters<Layout> params;
+    std::unique_ptr<typename FloatModel::Tables> tables;
+    if (!header.model_parameters.empty()) {
+        params.set_values(header.model_parameters);
+        tables.reset(new typename FloatModel::Tables(FloatModel::make_tables(params)));
+    }
+    const typename FloatModel::Tables &modelTables = tables ? *tables : FloatModel::default_tables();
+
+    const size_t channels = settings.channels;
+    std::vector<EntropyEstimator<FloatModel>> floatEstimates(channels, EntropyEstimator<FloatModel>(FloatModel(params, modelTables)));
+    std::vector<EntropyEstimator<FixedModel>> fixedEstimates(channels, EntropyEstimator<FixedModel>(FixedModel(params, modelTables)));
+    std::vector<EntropyEstimator<AdaptiveModel>> adaptiveEstimates(channels, EntropyEstimator<AdaptiveModel>(AdaptiveModel(params, modelTables)));
+    ThreadPool pool(settings.threads);
+
+    std::vector<int16_t> samples(CHUNK_FRAMES * channels);
+    std::vector<SymbolType> symbols(samples.size());
+    std::vector<std::vector<SymbolType>> channelSymbols(channels);
+    size_t count;
+
+    while ((count = neuralink_read_samples_from_stream(inputStream, samples.data(), samples.size())) > 0) {
+        neuralink_16bit_to_symbols<Layout::SYMBOL_BITS>(samples.data(), symbols.data(), count);
+        for (size_t c = 0; c < channels; ++c) {
+            channelSymbols[c].clear();
+        }
+        for (size_t i = 0; i < count; ) {
+            for (size_t c = 0; c < channels && i < count; ++c, ++i) {
+                channelSymbols[c].push_back(symbols[i]);
+            }
+        }
+        pool.parallel_for(channels, [&](size_t c) {
+            floatEstimates[c].add(channelSymbols[c].data(), channelSymbols[c].size());
+            fixedEstimates[c].add(channelSymbols[c].data(), channelSymbols[c].size());
+            adaptiveEstimates[c].add(channelSymbols[c].data(), channelSymbols[c].size());
+        });
+    }
+
+    static const char *names[] = {"float", "fixed", "adaptive"};
+    std::vector<std::array<double, 3>> bits(channels);
+    std::array<double, 3> totalBits = {0, 0, 0};
+    size_t totalSamples = 0;
+    for (size_t c = 0; c < channels; ++c) {
+        bits[c] = {floatEstimates[c].bits(), fixedEstimates[c].bits(), adaptiveEstimates[c].bits()};
+        for (size_t m = 0; m < 3; ++m) {
+            totalBits[m] += bits[c][m];
+        }
+        totalSamples += floatEstimates[c].symbols();
+    }
+
+    outputStream << "model        bits/sample        bytes    ratio" << std::endl;
+    for (size_t m = 0; m < 3; ++m) {
+        const double bytes = std::ceil(totalBits[m] / 8);
+        outputStream << std::left << std::setw(10) << names[m] << std::right << std::fixed
+                     << std::setw(14) << std::setprecision(4) << totalBits[m] / std::max<size_t>(totalSamples, 1)
+                     << std::setw(13) << std::setprecision(0) << bytes
+                     << std::setw(9) << std::setprecision(3) << 2.0 * totalSamples / std::max(bytes, 1.0) << std::endl;
+    }
+
+    if (channels > 1) {
+        outputStream << std::endl << "channel        float      fixed   adaptive  best" << std::endl;
+        for (size_t c = 0; c < channels; ++c) {
+            const double n = static_cast<double>(std::max<size_t>(floatEstimates[c].symbols(), 1));
+            const size_t best = std::min_element(bits[c].begin(), bits[c].end()) - bits[c].begin();
+            outputStream << std::left << std::setw(8) << c << std::right << std::setprecision(4);
+            for (size_t m = 0; m < 3; ++m) {
+                outputStream << std::setw(11) << bits[c][m] / n;
+            }
+            outputStream << "  " << names[best] << std::endl;
+        }
+    }
+}
+
+template <uint32_t TOTAL_FREQUENCY, typename Layout>
+void estimateModels(std::istream &, std::ostream &, const EncodeSettings &, const BrainwireHeader &, std::false_type) {
+    throw std::runtime_error("Unsupported frequency bits for the symbol bits");
+}
 
-    if (argc == 3) {
-        
-        const std::string inputFilePath = argv[1];
-        const std::string outputFilePath = argv[2];
 
-        std::ifstream inputFile(inputFilePath, std::ios::binary);
-        if (!inputFile) {
-            std::cerr << "Error opening input file: " << inputFilePath << std::endl;
+template <typename Layout>
+void estimateWithFrequency(std::istream &inputStream, std::ostream &outputStream, const EncodeSettings &settings, const BrainwireHeader &header) {
+    switch (header.frequency_bits) {
+    case 0:  estimateModels<0x7FFF, Layout>(inputStream, outputStream, settings, header, ModelSupports<0x7FFF, Layout>()); break;
+    case 12: estimateModels<(1u << 12), Layout>(inputStream, outputStream, settings, header, ModelSupports<(1u << 12), Layout>()); break;
+    case 13: estimateModels<(1u << 13), Layout>(inputStream, outputStream, settings, header, ModelSupports<(1u << 13), Layout>()); break;
+    case 14: estimateModels<(1u << 14), Layout>(inputStream, outputStream, settings, header, ModelSupports<(1u << 14), Layout>()); break;
+    case 15: estimateModels<(1u << 15), Layout>(inputStream, outputStream, settings, header, ModelSupports<(1u << 15), Layout>()); break;
+    default:
+        throw std::runtime_error("Unsupported frequency bits");
+    }
+}
+
+
+/**
+ * @brief Reads a recording and prints the estimated coded sizes, see estimateModels.
+ */
+void estimateStream(std::istream &inputStream, std::ostream &outputStream, const BrainwireHeader &header, EncodeSettings settings) {
+    const std::vector<uint8_t> wavHeader = read_wav_header(inputStream);
+    settings.channels = neuralink_check_wav_header(wavHeader);
+
+    if (header.block_size > 0 || header.packet_size > 0 || header.lanes > 0 || settings.archive || !header.stop_symbol) {
+        throw std::runtime_error("Estimates are not available with blocks, packets, lanes, archive mode or without stop symbols");
+    }
+
+    switch (header.symbol_bits) {
+    case 10: estimateWithFrequency<NeuralinkLayout>(inputStream, outputStream, settings, header); break;
+    case 12: estimateWithFrequency<ModelLayout<12, 4>>(inputStream, outputStream, settings, header); break;
+    default:
+        throw std::runtime_error("Unsupported symbol bits");
+    }
+}
+
+
+/**
+ * @brief encodeStream with the input read ahead and the output written on background threads.
+ *
+ * A mapped input is read on the coding thread, a reader thread would only copy its pages.
+ */
+void encodePipelined(std::istream &inputStream, std::ostream &outputStream, const BrainwireHeader &header, const EncodeSettings &settings, bool mappedInput) {
+    PipelinedOutputStream pipelinedOutput(outputStream);
+    if (mappedInput) {
+        encodeStream(inputStream, pipelinedOutput, header, settings);
+    } else {
+        PipelinedInputStream pipelinedInput(inputStream);
+        encodeStream(pipelinedInput, pipelinedOutput, header, settings);
+    }
+    pipelinedOutput.finish();
+}
+
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] [inputFile outputFile]" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --coder=arithmetic|range  entropy coder engine (default: arithmetic)" << std::endl;
+    std::cerr << "  --frequency-bits=12..15   use a 2^K frequency total, so the coders scale with shifts" << std::endl;
+    std::cerr << "  --model=float|fixed|adaptive" << std::endl;
+    std::cerr << "                            model state arithmetic, fixed needs no FPU, adaptive learns" << std::endl;
+    std::cerr << "                            the frequency tables from the recording (default: float)" << std::endl;
+    std::cerr << "  --parameters=FILE         model parameters fitted by tune, stored in the stream header" << std::endl;
+    std::cerr << "  --symbol-bits=10|12       bits per coded symbol, 12 keeps the top 12 bits of every sample" << std::endl;
+    std::cerr << "                            (default: 10, the resolution of the Neuralink data)" << std::endl;
+    std::cerr << "  --no-stop-symbol          end the substreams at the data size of the WAV header instead" << std::endl;
+    std::cerr << "                            of a stop symbol, for an alphabet of exactly 1024 symbols" << std::endl;
+    std::cerr << "  --block-size=N            code independently decodable blocks of N frames, with an index" << std::endl;
+    std::cerr << "  --packet-size=K           flush the coder every K samples (1 to 16384), so that every" << std::endl;
+    std::cerr << "                            packet decodes on arrival; mono recordings only" << std::endl;
+    std::cerr << "  --packet-report           print the size and flush overhead of every packet" << std::endl;
+    std::cerr << "  --lanes=N                 code a mono recording as N (2 to 8) independent segments," << std::endl;
+    std::cerr << "                            which the decoder advances together" << std::endl;
+    std::cerr << "  --archive                 code every channel of a multi-channel recording relative to a" << std::endl;
+    std::cerr << "                            prediction from the channels before it, fitted on its start" << std::endl;
+    std::cerr << "  --estimate                print the estimated coded size under every model instead of" << std::endl;
+    std::cerr << "                            encoding, the output file is omitted" << std::endl;
+    std::cerr << "  --no-pipeline             read, code and write on one thread" << std::endl;
+    std::cerr << "  --stats                   print coding statistics and phase timings to stderr" << std::endl;
+    std::cerr << "  --stats-window=N          samples per point of the bits/sample timeline (default: 2^20)" << std::endl;
+    std::cerr << "  --threads=N               threads coding channels or blocks" << std::endl;
+    std::cerr << "                            (default: number of hardware threads)" << std::endl;
+    std::cerr << "Without options mono recordings are written in the legacy (version 0) file format." << std::endl;
+    std::cerr << "Multi-channel recordings are coded as one substream per channel." << std::endl;
+}
+
+
+// the command-line tool, main reports the errors it throws
+int run(int argc, char* argv[]) {
+
+    // stream format options, the default is the legacy format
+    BrainwireHeader header;
+    EncodeSettings settings;
+    settings.threads = default_thread_count();
+
+    // statistics, the first entry holds the options for all channels
+    std::vector<CodingStats> stats(1);
+    PhaseTimer timer;
+    bool collectStats = false;
+    std::vector<std::string> paths;
+    std::string parametersPath;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--coder=arithmetic") {
+            header.coder = BrainwireCoder::Arithmetic;
+        } else if (arg == "--coder=range") {
+            header.coder = BrainwireCoder::Range;
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg.compare(0, 17, "--frequency-bits=") == 0) {
+            int bits = std::atoi(arg.c_str() + 17);
+            if (bits < 12 || bits > 15) {
+                std::cerr << "Unsupported frequency bits: " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+            header.frequency_bits = static_cast<uint8_t>(bits);
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg == "--model=float") {
+            header.model = BrainwireModel::FloatingPoint;
+        } else if (arg == "--model=fixed") {
+            header.model = BrainwireModel::FixedPoint;
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg == "--model=adaptive") {
+            header.model = BrainwireModel::Adaptive;
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg.compare(0, 13, "--parameters=") == 0) {
+            parametersPath = arg.substr(13);
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg.compare(0, 14, "--symbol-bits=") == 0) {
+            int bits = std::atoi(arg.c_str() + 14);
+            if (bits != 10 && bits != 12) {
+                std::cerr << "Unsupported symbol bits: " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+            header.symbol_bits = static_cast<uint8_t>(bits);
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg.compare(0, 13, "--block-size=") == 0) {
+            long frames = std::atol(arg.c_str() + 13);
+            if (frames < 1 || frames > (1L << 24)) {
+                std::cerr << "Unsupported block size: " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+            header.block_size = static_cast<uint32_t>(frames);
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg.compare(0, 14, "--packet-size=") == 0) {
+            long samples = std::atol(arg.c_str() + 14);
+            if (samples < 1 || samples > static_cast<long>(MAX_PACKET_SAMPLES)) {
+                std::cerr << "Unsupported packet size: " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+            header.packet_size = static_cast<uint16_t>(samples);
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg.compare(0, 8, "--lanes=") == 0) {
+            long lanes = std::atol(arg.c_str() + 8);
+            if (lanes < 2 || lanes > static_cast<long>(MAX_LANES)) {
+                std::cerr << "Unsupported number of lanes: " << arg << std::endl;
+                return EXIT_FAILURE;
+            }
+            header.lanes = static_cast<uint8_t>(lanes);
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg == "--no-stop-symbol") {
+            header.stop_symbol = false;
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg == "--archive") {
+            settings.archive = true;
+        } else if (arg == "--no-pipeline") {
+            settings.pipelined = false;
+        } else if (arg == "--estimate") {
+            settings.estimate = true;
+            header.version = BRAINWIRE_VERSION;
+        } else if (arg == "--packet-report") {
+            settings.packet_report = true;
+        } else if (arg == "--stats") {
+            collectStats = true;
+        } else if (arg.compare(0, 15, "--stats-window=") == 0) {
+            collectStats = true;
+            stats[0].window = std::max(1L, std::atol(arg.c_str() + 15));
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            settings.threads = std::max(1, std::atoi(arg.c_str() + 10));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    // the defaults of parameters missing from the file depend on the symbol bits
+    if (!parametersPath.empty()) {
+        std::ifstream parametersFile(parametersPath);
+        if (!parametersFile) {
+            std::cerr << "Error opening parameters file: " << parametersPath << std::endl;
             return EXIT_FAILURE;
         }
+        if (header.symbol_bits == 12) {
+            header.model_parameters = read_model_parameters<BasicModelParameters<ModelLayout<12, 4>>>(parametersFile).values();
+        } else {
+            header.model_parameters = read_model_parameters(parametersFile).values();
+        }
+    }
+
+    if (collectStats) {
+        settings.stats = &stats;
+        settings.timer = &timer;
+    }
+
+    if (settings.estimate && paths.size() <= 1) {
+
+        // Estimate from the input file or from standard input, without an output file
+        MappedInputStream mappedFile(paths.empty() ? std::string() : paths[0]);
+        std::ifstream inputFile;
+        if (!paths.empty() && !mappedFile.is_open()) {
+            inputFile.open(paths[0], std::ios::binary);
+            if (!inputFile) {
+                std::cerr << "Error opening input file: " << paths[0] << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::istream &input = paths.empty() ? std::cin : mappedFile.is_open() ? static_cast<std::istream&>(mappedFile) : inputFile;
+        if (settings.pipelined && !mappedFile.is_open()) {
+            PipelinedInputStream pipelinedInput(input);
+            estimateStream(pipelinedInput, std::cout, header, settings);
+        } else {
+            estimateStream(input, std::cout, header, settings);
+        }
+
+    } else if (paths.size() == 2 && !settings.estimate) {
+
+        const std::string inputFilePath = paths[0];
+        const std::string outputFilePath = paths[1];
 
-        // Open the output file stream
-        std::ofstream outputFile(outputFilePath, std::ios::binary);
+        // Map the input file, or read it as a regular file stream if it can not be mapped
+        MappedInputStream mappedFile(inputFilePath);
+        std::ifstream inputFile;
+        if (!mappedFile.is_open()) {
+            inputFile.open(inputFilePath, std::ios::binary);
+            if (!inputFile) {
+                std::cerr << "Error opening input file: " << inputFilePath << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+        std::istream &input = mappedFile.is_open() ? static_cast<std::istream&>(mappedFile) : inputFile;
+
+        // Open the output file stream with a large buffer
+        std::vector<char> outputBuffer(OUTPUT_BUFFER_SIZE);
+        std::ofstream outputFile;
+        outputFile.rdbuf()->pubsetbuf(outputBuffer.data(), outputBuffer.size());
+        outputFile.open(outputFilePath, std::ios::binary);
         if (!outputFile) {
             std::cerr << "Error opening output file: " << outputFilePath << std::endl;
             return EXIT_FAILURE;
         }
 
         // Process the streams
-        encodeStream(inputFile, outputFile);
+        if (settings.pipelined) {
+            encodePipelined(input, outputFile, header, settings, mappedFile.is_open());
+        } else {
+            encodeStream(input, outputFile, header, settings);
+        }
 
         // Close the file streams
-        inputFile.close();
         outputFile.close();
 
-    } else if (argc == 1) {
+    } else if (paths.empty()) {
         // Process standard input and output streams
-        encodeStream(std::cin, std::cout);
+        if (settings.pipelined) {
+            encodePipelined(std::cin, std::cout, header, settings, false);
+        } else {
+            encodeStream(std::cin, std::cout, header, settings);
+        }
 
     } else {
-        std::cerr << "Usage: " << argv[0] << " [inputFile outputFile]" << std::endl;
+        printUsage(argv[0]);
         return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;
 }
 
+
+int main(int argc, char* argv[]) {
+    try {
+        return run(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <string>
+#include "neuralink.hpp"
+
+/*
+ * Generates ccft_tables.hpp, the compile-time ccft tables of the default model parameters,
+ * or with --check verifies that the compiled-in tables are bit-identical to the runtime
+ * computation.
+ */
+
+
+template <uint32_t TOTAL_FREQUENCY>
+void generateTable(std::ostream &out, const char *name) {
+    using M = BasicModel<TOTAL_FREQUENCY>;
+    typename M::Tables t;
+    M::compute_ccft(ModelParameters(), t);
+
+    out << "static const uint16_t " << name << "[" << M::NUM_DIST << " * " << (M::NUM_SYMBOLS + 1) << "] = {\n";
+    for (int i = 0; i < M::NUM_DIST; ++i) {
+        out << "    // distribution " << i << "\n";
+        for (int j = 0; j <= M::NUM_SYMBOLS; ++j) {
+            if (j % 16 == 0) {
+                out << "    ";
+            }
+            out << t.ccft[i][j] << ",";
+            out << ((j % 16 == 15 || j == M::NUM_SYMBOLS) ? "\n" : " ");
+        }
+    }
+    out << "};\n\n";
+
+    out << "template <>\n";
+    out << "struct PrecomputedCcft<0x" << std::hex << std::uppercase << TOTAL_FREQUENCY << std::dec << "> {\n";
+    out << "    static constexpr size_t SIZE = " << M::NUM_DIST * (M::NUM_SYMBOLS + 1) << ";\n";
+    out << "    static const uint16_t* table() { return " << name << "; }\n";
+    out << "};\n\n";
+}
+
+
+template <uint32_t TOTAL_FREQUENCY>
+bool checkTable() {
+    using M = BasicModel<TOTAL_FREQUENCY>;
+    typename M::Tables t;
+    M::compute_ccft(ModelParameters(), t);
+
+    const uint16_t *precomputed = PrecomputedCcft<TOTAL_FREQUENCY>::table();
+    bool ok = precomputed != nullptr;
+    for (int i = 0; ok && i < M::NUM_DIST; ++i) {
+        for (int j = 0; j <= M::NUM_SYMBOLS; ++j) {
+            if (precomputed[i * (M::NUM_SYMBOLS + 1) + j] != t.ccft[i][j]) {
+                ok = false;
+                break;
+            }
+        }
+    }
+    std::cerr << "ccft table 0x" << std::hex << std::uppercase << TOTAL_FREQUENCY << std::dec
+              << (ok ? ": OK" : ": MISMATCH") << std::endl;
+    return ok;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    if (argc == 2 && std::string(argv[1]) == "--check") {
+        bool ok = checkTable<0x7FFF>();
+        ok = checkTable<0x8000>() && ok;
+        return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+
+    } else if (argc == 1) {
+        std::cout << "// Generated by gen_tables from the default ModelParameters, do not edit.\n";
+        std::cout << "// Regenerate with `make tables`, verify with `make check-tables`.\n";
+        std::cout << "#ifndef CCFT_TABLES_HPP\n";
+        std::cout << "#define CCFT_TABLES_HPP\n\n";
+        generateTable<0x7FFF>(std::cout, "CCFT_TABLE_7FFF");
+        generateTable<0x8000>(std::cout, "CCFT_TABLE_8000");
+        std::cout << "#endif\n";
+
+    } else {
+        std::cerr << "Usage: " << argv[0] << " [--check]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
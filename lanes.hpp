@@ -0,0 +1,207 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef LANES_HPP
+#define LANES_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "bitstream.hpp"
+#include "multichannel.hpp"
+
+/*
+ * Interleaved lanes payload layout
+ *
+ * When the stream header has more than one lane, a mono recording is cut into that many
+ * contiguous segments of equal length (the last one may be shorter), and every segment is
+ * coded by its own model and coder into its own substream:
+ *
+ *   8 bytes per lane   sample count and coded size in bytes of the lane (little endian)
+ *   ...                the lane substreams, in lane order
+ *
+ * The lanes hold no stop symbol. A single stream is one long dependency chain from the coder
+ * state through the model lookup and update to the next symbol; the lanes are independent
+ * chains, so the decoder advances all of them in one loop and the processor overlaps them.
+ */
+
+// Largest number of lanes
+static constexpr size_t MAX_LANES = 8;
+
+// Size of the table entry of a lane
+static constexpr size_t LANE_RECORD_SIZE = 8;
+
+
+/**
+ * @brief Codes a mono recording as interleaved lanes.
+ *
+ * @param symbols The symbols of the recording.
+ * @param count The number of symbols.
+ * @param lanes The number of lanes, 1 to MAX_LANES.
+ * @param bytes Receives the lane table and the substreams.
+ * @param model The initial model state of every lane.
+ */
+template <template <typename> class Encoder, typename M>
+void encode_lanes(const typename M::SymbolType *symbols, size_t count, size_t lanes, std::vector<uint8_t> &bytes, const M &model = M()) {
+    if (lanes == 0 || lanes > MAX_LANES) {
+        throw std::runtime_error("Unsupported number of lanes");
+    }
+    if (count > UINT32_MAX) {
+        throw std::runtime_error("Recording too large for lanes");
+    }
+    const size_t lane_size = (count + lanes - 1) / lanes;
+
+    std::vector<uint8_t> table(LANE_RECORD_SIZE * lanes);
+    std::vector<uint8_t> streams;
+    for (size_t k = 0; k < lanes; ++k) {
+        const size_t begin = std::min(count, k * lane_size);
+        const size_t end = std::min(count, begin + lane_size);
+
+        OBitStream bitstream;
+        Encoder<M> coder;
+        coder.model = model;
+        for (size_t i = begin; i < end; ++i) {
+            coder.encode(symbols[i], bitstream);
+            coder.model.update_state(symbols[i]);
+        }
+        coder.flush(bitstream);
+        bitstream.flush();
+
+        if (bitstream.size() > UINT32_MAX) {
+            throw std::runtime_error("Lane too large");
+        }
+        multichannel_put_u32(table.data() + LANE_RECORD_SIZE * k, static_cast<uint32_t>(end - begin));
+        multichannel_put_u32(table.data() + LANE_RECORD_SIZE * k + 4, static_cast<uint32_t>(bitstream.size()));
+        streams.insert(streams.end(), bitstream.data(), bitstream.data() + bitstream.size());
+    }
+
+    bytes = table;
+    bytes.insert(bytes.end(), streams.begin(), streams.end());
+}
+
+
+/**
+ * @brief Decodes the interleaved lanes of a mono recording.
+ *
+ * @tparam Decoder The coder engine, ArithmeticDecoder or RangeDecoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Decoder, typename M>
+class LaneDecoder {
+    using SymbolType = typename M::SymbolType;
+
+public:
+    /**
+     * @param lanes The number of lanes, 1 to MAX_LANES.
+     * @param model The initial model state of every lane, the same as the one of the encoder.
+     */
+    LaneDecoder(size_t lanes, const M &model = M()) : coders(lanes), counts(lanes), sizes(lanes) {
+        if (lanes == 0 || lanes > MAX_LANES) {
+            throw std::runtime_error("Unsupported number of lanes");
+        }
+        for (Decoder<M> &coder : coders) {
+            coder.model = model;
+        }
+    }
+
+    /**
+     * @brief Reads the lane table and all substreams into memory.
+     *
+     * @param inputStream The input stream positioned at the start of the payload.
+     * @param samples The number of samples of the recording, from its WAV header.
+     * @throws std::runtime_error if the payload is truncated or the lane counts do not add up
+     *         to `samples`.
+     */
+    void read(std::istream &inputStream, uint64_t samples) {
+        std::vector<uint8_t> table(LANE_RECORD_SIZE * coders.size());
+        if (!inputStream.read(reinterpret_cast<char*>(table.data()), table.size())) {
+            throw std::runtime_error("Truncated lane payload");
+        }
+        uint64_t total = 0;
+        uint64_t total_count = 0;
+        for (size_t k = 0; k < coders.size(); ++k) {
+            counts[k] = multichannel_get_u32(table.data() + LANE_RECORD_SIZE * k);
+            sizes[k] = multichannel_get_u32(table.data() + LANE_RECORD_SIZE * k + 4);
+            total += sizes[k];
+            total_count += counts[k];
+        }
+        // checked before the substreams and the samples are allocated
+        if (total_count != samples) {
+            throw std::runtime_error("Corrupt lane table");
+        }
+        read_payload(inputStream, total, payload, "Truncated lane payload");
+    }
+
+    /**
+     * @brief The number of samples of the recording.
+     */
+    size_t size() const {
+        size_t total = 0;
+        for (size_t count : counts) {
+            total += count;
+        }
+        return total;
+    }
+
+    /**
+     * @brief Decodes all lanes, advancing every lane by one symbol per step.
+     *
+     * @param symbols Receives the size() symbols of the recording.
+     */
+    void decode(SymbolType *symbols) {
+        const size_t lanes = coders.size();
+        std::vector<IBitStream> bitstreams;
+        std::vector<SymbolType*> outputs(lanes);
+        size_t offset = 0;
+        size_t common = SIZE_MAX;
+        for (size_t k = 0; k < lanes; ++k) {
+            bitstreams.emplace_back(payload.data() + offset, sizes[k]);
+            offset += sizes[k];
+            coders[k].init(bitstreams[k]);
+            outputs[k] = symbols;
+            symbols += counts[k];
+            common = std::min(common, counts[k]);
+        }
+
+        // the steps that advance every lane, these chains are independent
+        for (size_t i = 0; i < common; ++i) {
+            for (size_t k = 0; k < lanes; ++k) {
+                SymbolType symbol = coders[k].decode(bitstreams[k]);
+                coders[k].model.update_state(symbol);
+                outputs[k][i] = symbol;
+            }
+        }
+
+        // the remaining symbols of the longer lanes
+        for (size_t k = 0; k < lanes; ++k) {
+            for (size_t i = common; i < counts[k]; ++i) {
+                SymbolType symbol = coders[k].decode(bitstreams[k]);
+                coders[k].model.update_state(symbol);
+                outputs[k][i] = symbol;
+            }
+        }
+    }
+
+private:
+    std::vector<Decoder<M>> coders;
+    std::vector<size_t> counts;
+    std::vector<size_t> sizes;
+    std::vector<uint8_t> payload;
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define NEUROMASTERBLASTER_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * The kernel is advised that the mapping is read sequentially, so it reads ahead aggressively
+ * and drops pages behind the reader. On platforms without mmap the file is never open and
+ * callers fall back to regular file streams.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string &path) {
+#ifdef NEUROMASTERBLASTER_HAS_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            mappedSize = static_cast<size_t>(st.st_size);
+            if (mappedSize == 0) {
+                opened = true;
+            } else {
+                void *p = ::mmap(nullptr, mappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p != MAP_FAILED) {
+                    ::madvise(p, mappedSize, MADV_SEQUENTIAL);
+                    mappedData = static_cast<const uint8_t*>(p);
+                    opened = true;
+                }
+            }
+        }
+        ::close(fd);
+#else
+        (void)path;
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef NEUROMASTERBLASTER_HAS_MMAP
+        if (mappedData) {
+            ::munmap(const_cast<uint8_t*>(mappedData), mappedSize);
+        }
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool is_open() const {
+        return opened;
+    }
+
+    const uint8_t* data() const {
+        return mappedData;
+    }
+
+    size_t size() const {
+        return mappedSize;
+    }
+
+private:
+    const uint8_t *mappedData = nullptr;
+    size_t mappedSize = 0;
+    bool opened = false;
+};
+
+
+/**
+ * @brief A seekable stream buffer over a block of memory, reads are plain copies.
+ */
+class MemoryStreamBuf : public std::streambuf {
+public:
+    MemoryStreamBuf(const uint8_t *data, size_t size) {
+        char *begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) {
+            return pos_type(off_type(-1));
+        }
+        off_type base = 0;
+        if (dir == std::ios_base::cur) {
+            base = gptr() - eback();
+        } else if (dir == std::ios_base::end) {
+            base = egptr() - eback();
+        }
+        const off_type pos = base + off;
+        if (pos < 0 || pos > egptr() - eback()) {
+            return pos_type(off_type(-1));
+        }
+        setg(eback(), eback() + pos, egptr());
+        return pos_type(pos);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+};
+
+
+/**
+ * @brief A stream buffer that reads a block of memory, and then the rest of another stream.
+ *
+ * Puts back the start of a stream that was read ahead, for example the samples of the archive
+ * mode fit, without buffering the rest of the stream.
+ */
+class PrefixStreamBuf : public std::streambuf {
+public:
+    PrefixStreamBuf(const uint8_t *data, size_t size, std::istream &rest) : rest(rest), buffer(1 << 16) {
+        char *begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() == egptr()) {
+            rest.read(buffer.data(), buffer.size());
+            setg(buffer.data(), buffer.data(), buffer.data() + rest.gcount());
+        }
+        return gptr() == egptr() ? traits_type::eof() : traits_type::to_int_type(*gptr());
+    }
+
+    std::streamsize xsgetn(char *s, std::streamsize n) override {
+        const std::streamsize buffered = std::min<std::streamsize>(n, egptr() - gptr());
+        std::copy(gptr(), gptr() + buffered, s);
+        setg(eback(), gptr() + buffered, egptr());
+        if (buffered == n) {
+            return n;
+        }
+        rest.read(s + buffered, n - buffered);
+        return buffered + rest.gcount();
+    }
+
+private:
+    std::istream &rest;
+    std::vector<char> buffer;
+};
+
+
+/**
+ * @brief An input stream that reads a file through a memory mapping.
+ *
+ * Large reads are copies straight out of the page cache, without the buffering and the
+ * read system calls of std::ifstream. Check is_open() and fall back to std::ifstream when the
+ * file can not be mapped, for example when it is a pipe.
+ */
+class MappedInputStream : public std::istream {
+public:
+    explicit MappedInputStream(const std::string &path)
+        : std::istream(nullptr), file(path), buffer(file.data(), file.size()) {
+        rdbuf(&buffer);
+        if (!file.is_open()) {
+            setstate(std::ios_base::failbit);
+        }
+    }
+
+    bool is_open() const {
+        return file.is_open();
+    }
+
+private:
+    MappedFile file;
+    MemoryStreamBuf buffer;
+};
+
+#endif
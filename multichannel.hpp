@@ -0,0 +1,485 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef MULTICHANNEL_HPP
+#define MULTICHANNEL_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+#include "bitstream.hpp"
+#include "stats.hpp"
+#include "threadpool.hpp"
+
+/*
+ * Multi-channel payload layout
+ *
+ * Recordings with more than one interleaved channel are coded as one independent substream
+ * per channel, each with its own model and coder state and terminated by its own stop symbol:
+ *
+ *   4 bytes per channel   substream sizes in bytes (little endian)
+ *   ...                   the substreams, in channel order
+ *
+ * MultiChannelEncoder and MultiChannelDecoder keep a coder, with its model, and a bit stream
+ * per channel. The structure of arrays layout of the model states of many channels is
+ * MultiChannelBatchEncoder in batch.hpp.
+ */
+
+
+// largest allocation made ahead of the bytes read from a stream that can not seek
+static constexpr size_t PAYLOAD_READ_CHUNK = 1 << 20;
+
+
+/**
+ * @brief Writes a 32 bit little endian value to a byte buffer.
+ */
+inline void multichannel_put_u32(uint8_t *bytes, uint32_t value) {
+    for (int i = 0; i < 4; ++i) {
+        bytes[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+
+/**
+ * @brief Reads a 32 bit little endian value from a byte buffer.
+ */
+inline uint32_t multichannel_get_u32(const uint8_t *bytes) {
+    uint32_t value = 0;
+    for (int i = 0; i < 4; ++i) {
+        value |= static_cast<uint32_t>(bytes[i]) << (8 * i);
+    }
+    return value;
+}
+
+
+/**
+ * @brief The substream size table of the per-channel bit streams.
+ *
+ * @throws std::runtime_error if a substream is too large for the table.
+ */
+inline std::vector<uint8_t> multichannel_size_table(const std::vector<OBitStream> &bitstreams) {
+    std::vector<uint8_t> sizes(4 * bitstreams.size());
+    for (size_t c = 0; c < bitstreams.size(); ++c) {
+        if (bitstreams[c].size() > UINT32_MAX) {
+            throw std::runtime_error("Channel substream too large");
+        }
+        multichannel_put_u32(&sizes[4 * c], static_cast<uint32_t>(bitstreams[c].size()));
+    }
+    return sizes;
+}
+
+
+/**
+ * @brief Writes the substream size table followed by the substreams.
+ */
+inline void multichannel_write(std::ostream &outputStream, const std::vector<OBitStream> &bitstreams) {
+    const std::vector<uint8_t> sizes = multichannel_size_table(bitstreams);
+    outputStream.write(reinterpret_cast<const char*>(sizes.data()), sizes.size());
+    for (const OBitStream &bitstream : bitstreams) {
+        outputStream.write(reinterpret_cast<const char*>(bitstream.data()), bitstream.size());
+    }
+}
+
+
+/**
+ * @brief Appends the substream size table followed by the substreams to a byte buffer.
+ */
+inline void multichannel_write(std::vector<uint8_t> &bytes, const std::vector<OBitStream> &bitstreams) {
+    const std::vector<uint8_t> sizes = multichannel_size_table(bitstreams);
+    bytes.insert(bytes.end(), sizes.begin(), sizes.end());
+    for (const OBitStream &bitstream : bitstreams) {
+        bytes.insert(bytes.end(), bitstream.data(), bitstream.data() + bitstream.size());
+    }
+}
+
+
+/**
+ * @brief The number of bytes after the read position, or UINT64_MAX if the stream can not seek.
+ */
+inline uint64_t stream_remaining(std::istream &inputStream) {
+    const std::streampos pos = inputStream.tellg();
+    if (pos < 0 || !inputStream.seekg(0, std::ios::end)) {
+        inputStream.clear(inputStream.rdstate() & std::ios::badbit);
+        return UINT64_MAX;
+    }
+    const std::streampos end = inputStream.tellg();
+    inputStream.seekg(pos);
+    return end > pos ? static_cast<uint64_t>(end - pos) : 0;
+}
+
+
+/**
+ * @brief Reads a payload of a size that was read from the stream itself.
+ *
+ * The size is checked against the rest of a seekable stream before anything is allocated. A
+ * stream that can not seek is read in chunks of PAYLOAD_READ_CHUNK bytes, so a corrupt size
+ * only allocates about as much as the stream holds.
+ *
+ * @throws std::runtime_error with the message if the stream ends before `size` bytes.
+ */
+inline void read_payload(std::istream &inputStream, uint64_t size, std::vector<uint8_t> &payload, const char *message) {
+    if (size > stream_remaining(inputStream)) {
+        throw std::runtime_error(message);
+    }
+    payload.clear();
+    while (payload.size() < size) {
+        const size_t begin = payload.size();
+        payload.resize(begin + static_cast<size_t>(std::min<uint64_t>(size - begin, PAYLOAD_READ_CHUNK)));
+        if (!inputStream.read(reinterpret_cast<char*>(payload.data() + begin), payload.size() - begin)) {
+            throw std::runtime_error(message);
+        }
+    }
+}
+
+
+/**
+ * @brief The total size of the substreams listed in a size table.
+ */
+inline uint64_t multichannel_payload_size(const uint8_t *sizes, size_t channels) {
+    uint64_t total = 0;
+    for (size_t c = 0; c < channels; ++c) {
+        total += multichannel_get_u32(&sizes[4 * c]);
+    }
+    return total;
+}
+
+
+/**
+ * @brief Reads the substream size table and the substreams of a payload.
+ *
+ * @param inputStream The input stream positioned at the start of the payload.
+ * @param channels The number of channels.
+ * @param sizes Receives the size table.
+ * @param payload Receives the substreams.
+ * @throws std::runtime_error if the payload is truncated, also before allocating a size table
+ *         total beyond the end of the input.
+ */
+inline void multichannel_read(std::istream &inputStream, size_t channels, std::vector<uint8_t> &sizes, std::vector<uint8_t> &payload) {
+    sizes.resize(4 * channels);
+    if (!inputStream.read(reinterpret_cast<char*>(sizes.data()), sizes.size())) {
+        throw std::runtime_error("Truncated multi-channel payload");
+    }
+    read_payload(inputStream, multichannel_payload_size(sizes.data(), channels), payload, "Truncated multi-channel payload");
+}
+
+
+/**
+ * @brief Copies the substream size table and the substreams of a payload from memory.
+ *
+ * @throws std::runtime_error if the payload is truncated.
+ */
+inline void multichannel_read(const uint8_t *bytes, size_t size, size_t channels, std::vector<uint8_t> &sizes, std::vector<uint8_t> &payload) {
+    const size_t table_size = 4 * channels;
+    if (size < table_size || size - table_size < multichannel_payload_size(bytes, channels)) {
+        throw std::runtime_error("Truncated multi-channel payload");
+    }
+    sizes.assign(bytes, bytes + table_size);
+    payload.assign(bytes + table_size, bytes + table_size + static_cast<size_t>(multichannel_payload_size(bytes, channels)));
+}
+
+
+/**
+ * @brief Interleaves per-channel runs of symbols, finished channels keep the order of the others.
+ *
+ * @param channel_symbols The run of every channel, at most `frames` symbols each.
+ * @param frames The number of frames.
+ * @param symbols Receives the interleaved symbols.
+ * @return The number of symbols written.
+ */
+template <typename SymbolType>
+size_t multichannel_interleave(const std::vector<std::vector<SymbolType>> &channel_symbols, size_t frames, SymbolType *symbols) {
+    size_t count = 0;
+    for (size_t t = 0; t < frames; ++t) {
+        for (size_t c = 0; c < channel_symbols.size(); ++c) {
+            if (t < channel_symbols[c].size()) {
+                symbols[count++] = channel_symbols[c][t];
+            }
+        }
+    }
+    return count;
+}
+
+
+/**
+ * @brief Encodes interleaved multi-channel symbols into one substream per channel.
+ *
+ * The per-channel coder states (which share the immutable model tables) and the per-channel
+ * output buffers are kept in separate contiguous arrays. The channels are independent, so a
+ * ThreadPool codes them concurrently, each into its own buffer.
+ *
+ * @tparam Encoder The coder engine, ArithmeticEncoder or RangeEncoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Encoder, typename M>
+class MultiChannelEncoder {
+    using SymbolType = typename M::SymbolType;
+
+public:
+    /**
+     * @param channels The number of interleaved channels.
+     * @param model The initial model state of every channel.
+     */
+    explicit MultiChannelEncoder(size_t channels, const M &model = M())
+        : coders(channels), bitstreams(channels), channel_symbols(channels) {
+        for (Encoder<M> &coder : coders) {
+            coder.model = model;
+        }
+    }
+
+    size_t channels() const {
+        return coders.size();
+    }
+
+    /**
+     * @brief Collects the coding statistics of channel c into (*stats)[c], nullptr disables them.
+     */
+    void set_stats(std::vector<CodingStats> *stats) {
+        this->stats = stats;
+    }
+
+    /**
+     * @brief Encodes a chunk of interleaved symbols.
+     *
+     * @param symbols The interleaved symbols, starting at channel 0.
+     * @param count The number of symbols, a multiple of the channel count except for the last chunk.
+     * @param pool The threads that code the channels.
+     */
+    void encode(const SymbolType *symbols, size_t count, ThreadPool &pool) {
+        const size_t num_channels = coders.size();
+
+        // split the chunk into per-channel runs
+        for (size_t c = 0; c < num_channels; ++c) {
+            channel_symbols[c].clear();
+        }
+        for (size_t i = 0; i < count; ) {
+            for (size_t c = 0; c < num_channels && i < count; ++c, ++i) {
+                channel_symbols[c].push_back(symbols[i]);
+            }
+        }
+
+        pool.parallel_for(num_channels, [this](size_t c) {
+            encode_channel(c, channel_symbols[c].data(), channel_symbols[c].size());
+        });
+    }
+
+    /**
+     * @brief Encodes consecutive symbols of a single channel.
+     */
+    void encode_channel(size_t c, const SymbolType *symbols, size_t count) {
+        Encoder<M> &coder = coders[c];
+        OBitStream &bitstream = bitstreams[c];
+        if (stats) {
+            CodingStats &channel_stats = (*stats)[c];
+            for (size_t i = 0; i < count; ++i) {
+                coder.encode(symbols[i], bitstream);
+                coder.model.update_state(symbols[i]);
+                channel_stats.record_encoded(coder);
+            }
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            coder.encode(symbols[i], bitstream);
+            coder.model.update_state(symbols[i]);
+        }
+    }
+
+    /**
+     * @brief Terminates every substream with a stop symbol, if the model has one.
+     */
+    void finish() {
+        for (size_t c = 0; c < coders.size(); ++c) {
+            if (M::HAS_STOP) {
+                coders[c].encode(M::STOP_SYMBOL, bitstreams[c]);
+            }
+            coders[c].flush(bitstreams[c]);
+            bitstreams[c].flush();
+        }
+    }
+
+    /**
+     * @brief Writes the substream size table followed by the substreams, call after finish().
+     *
+     * @param outputStream The output stream to write to.
+     */
+    void write(std::ostream &outputStream) const {
+        multichannel_write(outputStream, bitstreams);
+    }
+
+    /**
+     * @brief Appends the substream size table followed by the substreams to a byte buffer.
+     */
+    void write(std::vector<uint8_t> &bytes) const {
+        multichannel_write(bytes, bitstreams);
+    }
+
+private:
+    std::vector<Encoder<M>> coders;
+    std::vector<OBitStream> bitstreams;
+    std::vector<std::vector<SymbolType>> channel_symbols;
+    std::vector<CodingStats> *stats = nullptr;
+};
+
+
+/**
+ * @brief Decodes the per-channel substreams of a multi-channel payload back to interleaved symbols.
+ *
+ * @tparam Decoder The coder engine, ArithmeticDecoder or RangeDecoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Decoder, typename M>
+class MultiChannelDecoder {
+    using SymbolType = typename M::SymbolType;
+
+public:
+    /**
+     * @param channels The number of interleaved channels.
+     * @param model The initial model state of every channel, the same as the one of the encoder.
+     */
+    explicit MultiChannelDecoder(size_t channels, const M &model = M())
+        : coders(channels), channel_symbols(channels), finished(channels, 0), remaining(channels, UINT64_MAX) {
+        for (Decoder<M> &coder : coders) {
+            coder.model = model;
+        }
+    }
+
+    /**
+     * @brief Sets the number of interleaved samples, for substreams without stop symbols.
+     *
+     * Channel c then finishes after its share of the frames, the first channels get one
+     * more sample if the last frame is incomplete.
+     */
+    void set_samples(uint64_t samples) {
+        const size_t num_channels = coders.size();
+        for (size_t c = 0; c < num_channels; ++c) {
+            remaining[c] = samples > c ? (samples - c + num_channels - 1) / num_channels : 0;
+        }
+    }
+
+    /**
+     * @brief Collects the coding statistics of channel c into (*stats)[c], nullptr disables them.
+     */
+    void set_stats(std::vector<CodingStats> *stats) {
+        this->stats = stats;
+    }
+
+    /**
+     * @brief Reads the substream size table and all substreams into memory.
+     *
+     * @param inputStream The input stream positioned at the start of the payload.
+     * @throws std::runtime_error if the payload is truncated.
+     */
+    void read(std::istream &inputStream) {
+        std::vector<uint8_t> sizes;
+        multichannel_read(inputStream, coders.size(), sizes, payload);
+        attach(sizes.data());
+    }
+
+    /**
+     * @brief Copies a multi-channel payload, the size table followed by the substreams, from memory.
+     *
+     * @throws std::runtime_error if the payload is truncated.
+     */
+    void read(const uint8_t *bytes, size_t size) {
+        std::vector<uint8_t> sizes;
+        multichannel_read(bytes, size, coders.size(), sizes, payload);
+        attach(sizes.data());
+    }
+
+    /**
+     * @brief Decodes up to `frames` symbols of every channel and interleaves them.
+     *
+     * A channel is finished when its stop symbol is decoded or its samples, see set_samples,
+     * are decoded. The remaining channels keep their interleaved order.
+     *
+     * @param symbols Receives the interleaved symbols, room for `frames` times the channel count.
+     * @param frames The maximum number of symbols to decode per channel.
+     * @param pool The threads that decode the channels.
+     * @return The number of symbols decoded, 0 when all channels are finished.
+     */
+    size_t decode(SymbolType *symbols, size_t frames, ThreadPool &pool) {
+        const size_t num_channels = coders.size();
+
+        pool.parallel_for(num_channels, [this, frames](size_t c) {
+            channel_symbols[c].resize(frames);
+            channel_symbols[c].resize(decode_channel(c, channel_symbols[c].data(), frames));
+        });
+
+        return multichannel_interleave(channel_symbols, frames, symbols);
+    }
+
+    /**
+     * @brief Decodes up to `capacity` symbols of a single channel, stopping at its stop symbol.
+     *
+     * @return The number of symbols decoded.
+     */
+    size_t decode_channel(size_t c, SymbolType *symbols, size_t capacity) {
+        Decoder<M> &coder = coders[c];
+        IBitStream &bitstream = bitstreams[c];
+        size_t count = 0;
+        if (!stats && !finished[c]) {
+            const size_t span = static_cast<size_t>(std::min<uint64_t>(capacity, remaining[c]));
+            count = coder.decode_n(bitstream, symbols, span);
+            remaining[c] -= count;
+            finished[c] = count < span || remaining[c] == 0;
+            return count;
+        }
+        while (!finished[c] && count < capacity) {
+            if (remaining[c] == 0) {
+                finished[c] = 1;
+                break;
+            }
+            SymbolType symbol = coder.decode(bitstream);
+            coder.model.update_state(symbol);
+            if (M::HAS_STOP && symbol == M::STOP_SYMBOL) {
+                finished[c] = 1;
+            } else {
+                remaining[c]--;
+                symbols[count++] = symbol;
+                if (stats) {
+                    (*stats)[c].record_decoded(coder);
+                }
+            }
+        }
+        return count;
+    }
+
+private:
+    std::vector<Decoder<M>> coders;
+    std::vector<IBitStream> bitstreams;
+    std::vector<std::vector<SymbolType>> channel_symbols;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> finished; // not a vector<bool>, channels are decoded concurrently
+    std::vector<uint64_t> remaining; // samples left per channel, UINT64_MAX until the stop symbol
+    std::vector<CodingStats> *stats = nullptr;
+
+    // points the per-channel bitstreams into the payload and starts the coders
+    void attach(const uint8_t *sizes) {
+        const size_t num_channels = coders.size();
+        bitstreams.clear();
+        bitstreams.reserve(num_channels);
+        size_t offset = 0;
+        for (size_t c = 0; c < num_channels; ++c) {
+            const size_t size = multichannel_get_u32(&sizes[4 * c]);
+            bitstreams.emplace_back(payload.data() + offset, size);
+            coders[c].init(bitstreams[c]);
+            offset += size;
+        }
+    }
+};
+
+#endif
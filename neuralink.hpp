@@ -23,6 +23,24 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <memory>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <cstdlib>
+#include <cstring>
+#include "checkpoint.hpp"
+
+// x86 SIMD kernels are compiled for several instruction sets and selected at runtime
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define NEUROMASTERBLASTER_X86_DISPATCH 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 
 // Symbols are 10 bit unsigned integers [0..1023] stored in the lowest bits of an unsigend 16 bit integer.
@@ -40,7 +58,7 @@ typedef uint16_t FrequencyType;
  * @param x The signed 16-bit input value.
  * @return The unsigned 10-bit output value in the range [0, 1023].
  */
-SymbolType neuralink_16bit_to_10bit(int16_t x) {
+inline SymbolType neuralink_16bit_to_10bit(int16_t x) {
     return (x >> 6) + 512;
 }
 
@@ -56,12 +74,327 @@ SymbolType neuralink_16bit_to_10bit(int16_t x) {
  * @return The reconstructed signed 16-bit output value.
  * @note This transform has some magic numbers that were experimentally recovered from example data.
  */
-int16_t neuralink_10bit_to_16bit(SymbolType u) {
+inline int16_t neuralink_10bit_to_16bit(SymbolType u) {
     double temp = (u - 512 + 0.5) * (64.0 + 1009.0 / 16384.0) - 0.5;
     return static_cast<int16_t>(std::trunc(temp));
 }
 
 
+/**
+ * @brief Returns a table with the 16-bit reconstruction of each of the 1024 symbols.
+ */
+inline const std::array<int16_t, 1024> &neuralink_10bit_to_16bit_table() {
+    static const std::array<int16_t, 1024> table = [] {
+        std::array<int16_t, 1024> t;
+        for (SymbolType u = 0; u < 1024; ++u) {
+            t[u] = neuralink_10bit_to_16bit(u);
+        }
+        return t;
+    }();
+    return table;
+}
+
+
+/**
+ * @brief The instruction sets of the vectorized span conversions.
+ */
+enum class NeuralinkSimd : uint8_t {
+    Scalar = 0,
+    SSE2 = 1,   ///< 16 to 10 bit only, 10 to 16 bit uses the table
+    SSE41 = 2,
+    AVX2 = 3,
+    AVX512 = 4, ///< AVX-512 F and BW
+    NEON = 5    ///< selected at compile time, NEON is part of the AArch64 baseline
+};
+
+
+/**
+ * @brief Returns the name of an instruction set level, as accepted by NEUROMASTERBLASTER_SIMD.
+ */
+inline const char *neuralink_simd_name(NeuralinkSimd simd) {
+    static const char *names[] = {"scalar", "sse2", "sse4.1", "avx2", "avx512", "neon"};
+    return names[static_cast<int>(simd)];
+}
+
+
+/**
+ * @brief The best instruction set of the span conversions that the processor supports.
+ *
+ * Detected once per process. The environment variable NEUROMASTERBLASTER_SIMD selects a
+ * lower level, e.g. to compare the kernels on one host; levels the processor does not
+ * support are ignored.
+ */
+inline NeuralinkSimd neuralink_simd() {
+    static const NeuralinkSimd level = [] {
+        NeuralinkSimd best = NeuralinkSimd::Scalar;
+#if defined(NEUROMASTERBLASTER_X86_DISPATCH)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+            best = NeuralinkSimd::AVX512;
+        } else if (__builtin_cpu_supports("avx2")) {
+            best = NeuralinkSimd::AVX2;
+        } else if (__builtin_cpu_supports("sse4.1")) {
+            best = NeuralinkSimd::SSE41;
+        } else if (__builtin_cpu_supports("sse2")) {
+            best = NeuralinkSimd::SSE2;
+        }
+#elif defined(__ARM_NEON)
+        best = NeuralinkSimd::NEON;
+#endif
+        const char *requested = std::getenv("NEUROMASTERBLASTER_SIMD");
+        for (int i = 0; requested && i <= static_cast<int>(best); ++i) {
+            if (std::strcmp(requested, neuralink_simd_name(static_cast<NeuralinkSimd>(i))) == 0) {
+                return static_cast<NeuralinkSimd>(i);
+            }
+        }
+        return best;
+    }();
+    return level;
+}
+
+
+#if defined(NEUROMASTERBLASTER_X86_DISPATCH)
+
+__attribute__((target("sse2")))
+inline size_t neuralink_16bit_to_10bit_sse2(const int16_t *samples, SymbolType *symbols, size_t count) {
+    const __m128i offset = _mm_set1_epi16(512);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(symbols + i), _mm_add_epi16(_mm_srai_epi16(x, 6), offset));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t neuralink_16bit_to_10bit_avx2(const int16_t *samples, SymbolType *symbols, size_t count) {
+    const __m256i offset = _mm256_set1_epi16(512);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(samples + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(symbols + i), _mm256_add_epi16(_mm256_srai_epi16(x, 6), offset));
+    }
+    return i;
+}
+
+// GCC 12 reports the _mm512_undefined_* placeholders inside its AVX-512 intrinsics as uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t neuralink_16bit_to_10bit_avx512(const int16_t *samples, SymbolType *symbols, size_t count) {
+    const __m512i offset = _mm512_set1_epi16(512);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m512i x = _mm512_loadu_si512(samples + i);
+        _mm512_storeu_si512(symbols + i, _mm512_add_epi16(_mm512_srai_epi16(x, 6), offset));
+    }
+    return i;
+}
+
+__attribute__((target("sse4.1")))
+inline size_t neuralink_10bit_to_16bit_sse41(const SymbolType *symbols, int16_t *samples, size_t count) {
+    const __m128i bias = _mm_set1_epi32(1023);
+    const __m128i scale = _mm_set1_epi32(1049585);
+    const __m128i half = _mm_set1_epi32(16384);
+    const __m128i round = _mm_set1_epi32(32767);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(symbols + i));
+        __m128i lo = _mm_cvtepu16_epi32(u);
+        __m128i hi = _mm_cvtepu16_epi32(_mm_srli_si128(u, 8));
+        lo = _mm_sub_epi32(_mm_mullo_epi32(_mm_sub_epi32(_mm_slli_epi32(lo, 1), bias), scale), half);
+        hi = _mm_sub_epi32(_mm_mullo_epi32(_mm_sub_epi32(_mm_slli_epi32(hi, 1), bias), scale), half);
+        lo = _mm_srai_epi32(_mm_add_epi32(lo, _mm_and_si128(_mm_srai_epi32(lo, 31), round)), 15);
+        hi = _mm_srai_epi32(_mm_add_epi32(hi, _mm_and_si128(_mm_srai_epi32(hi, 31), round)), 15);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), _mm_packs_epi32(lo, hi));
+    }
+    return i;
+}
+
+__attribute__((target("avx2")))
+inline size_t neuralink_10bit_to_16bit_avx2(const SymbolType *symbols, int16_t *samples, size_t count) {
+    const __m256i bias = _mm256_set1_epi32(1023);
+    const __m256i scale = _mm256_set1_epi32(1049585);
+    const __m256i half = _mm256_set1_epi32(16384);
+    const __m256i round = _mm256_set1_epi32(32767);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i u = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(symbols + i)));
+        __m256i n = _mm256_sub_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(_mm256_slli_epi32(u, 1), bias), scale), half);
+        n = _mm256_srai_epi32(_mm256_add_epi32(n, _mm256_and_si256(_mm256_srai_epi32(n, 31), round)), 15);
+        __m128i packed = _mm_packs_epi32(_mm256_castsi256_si128(n), _mm256_extracti128_si256(n, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(samples + i), packed);
+    }
+    return i;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+inline size_t neuralink_10bit_to_16bit_avx512(const SymbolType *symbols, int16_t *samples, size_t count) {
+    const __m512i bias = _mm512_set1_epi32(1023);
+    const __m512i scale = _mm512_set1_epi32(1049585);
+    const __m512i half = _mm512_set1_epi32(16384);
+    const __m512i round = _mm512_set1_epi32(32767);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512i u = _mm512_cvtepu16_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(symbols + i)));
+        __m512i n = _mm512_sub_epi32(_mm512_mullo_epi32(_mm512_sub_epi32(_mm512_slli_epi32(u, 1), bias), scale), half);
+        n = _mm512_srai_epi32(_mm512_add_epi32(n, _mm512_and_si512(_mm512_srai_epi32(n, 31), round)), 15);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(samples + i), _mm512_cvtepi32_epi16(n));
+    }
+    return i;
+}
+
+#pragma GCC diagnostic pop
+
+#endif
+
+
+/**
+ * @brief Converts a span of signed 16-bit samples to 10-bit symbols.
+ *
+ * Bit-exact with the scalar neuralink_16bit_to_10bit. On x86 the kernel is chosen at runtime
+ * by neuralink_simd(), from SSE2, AVX2 and AVX-512 variants, so a generic build runs the
+ * widest kernel of the processor. NEON is used when the target supports it.
+ *
+ * @param samples The signed 16-bit input samples.
+ * @param symbols Receives the 10-bit symbols.
+ * @param count The number of samples.
+ */
+inline void neuralink_16bit_to_10bit(const int16_t *samples, SymbolType *symbols, size_t count) {
+    size_t i = 0;
+#if defined(NEUROMASTERBLASTER_X86_DISPATCH)
+    switch (neuralink_simd()) {
+    case NeuralinkSimd::AVX512: i = neuralink_16bit_to_10bit_avx512(samples, symbols, count); break;
+    case NeuralinkSimd::AVX2:   i = neuralink_16bit_to_10bit_avx2(samples, symbols, count); break;
+    case NeuralinkSimd::SSE41:
+    case NeuralinkSimd::SSE2:   i = neuralink_16bit_to_10bit_sse2(samples, symbols, count); break;
+    default: break;
+    }
+#elif defined(__ARM_NEON)
+    const int16x8_t offset = vdupq_n_s16(512);
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t x = vld1q_s16(samples + i);
+        vst1q_u16(symbols + i, vreinterpretq_u16_s16(vaddq_s16(vshrq_n_s16(x, 6), offset)));
+    }
+#endif
+    for (; i < count; ++i) {
+        symbols[i] = neuralink_16bit_to_10bit(samples[i]);
+    }
+}
+
+
+/**
+ * @brief Converts a span of 10-bit symbols back to signed 16-bit samples.
+ *
+ * Bit-exact with the scalar neuralink_10bit_to_16bit. The reconstruction
+ * (u - 511.5) * (64 + 1009 / 16384) - 0.5 equals ((2u - 1023) * 1049585 - 16384) / 32768
+ * exactly, which the SSE4.1, AVX2, AVX-512 and NEON kernels evaluate in 32-bit integers with a
+ * division that truncates toward zero. Without them the samples are looked up in
+ * neuralink_10bit_to_16bit_table.
+ *
+ * @param symbols The 10-bit input symbols in the range [0, 1023].
+ * @param samples Receives the signed 16-bit samples.
+ * @param count The number of symbols.
+ */
+inline void neuralink_10bit_to_16bit(const SymbolType *symbols, int16_t *samples, size_t count) {
+    size_t i = 0;
+#if defined(NEUROMASTERBLASTER_X86_DISPATCH)
+    switch (neuralink_simd()) {
+    case NeuralinkSimd::AVX512: i = neuralink_10bit_to_16bit_avx512(symbols, samples, count); break;
+    case NeuralinkSimd::AVX2:   i = neuralink_10bit_to_16bit_avx2(symbols, samples, count); break;
+    case NeuralinkSimd::SSE41:  i = neuralink_10bit_to_16bit_sse41(symbols, samples, count); break;
+    default: break;
+    }
+#elif defined(__ARM_NEON)
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t u = vld1q_u16(symbols + i);
+        int32x4_t lo = vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(u)));
+        int32x4_t hi = vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(u)));
+        lo = vsubq_s32(vmulq_n_s32(vsubq_s32(vshlq_n_s32(lo, 1), vdupq_n_s32(1023)), 1049585), vdupq_n_s32(16384));
+        hi = vsubq_s32(vmulq_n_s32(vsubq_s32(vshlq_n_s32(hi, 1), vdupq_n_s32(1023)), 1049585), vdupq_n_s32(16384));
+        lo = vshrq_n_s32(vaddq_s32(lo, vandq_s32(vshrq_n_s32(lo, 31), vdupq_n_s32(32767))), 15);
+        hi = vshrq_n_s32(vaddq_s32(hi, vandq_s32(vshrq_n_s32(hi, 31), vdupq_n_s32(32767))), 15);
+        vst1q_s16(samples + i, vcombine_s16(vmovn_s32(lo), vmovn_s32(hi)));
+    }
+#endif
+    const std::array<int16_t, 1024> &table = neuralink_10bit_to_16bit_table();
+    for (; i < count; ++i) {
+        samples[i] = table[symbols[i] & 1023];
+    }
+}
+
+
+/**
+ * @brief Converts a signed 16-bit value to an unsigned SYMBOL_BITS value.
+ *
+ * The value is shifted right by 16 - SYMBOL_BITS bits and offset by 2^(SYMBOL_BITS - 1), the
+ * 10-bit conversion is neuralink_16bit_to_10bit.
+ */
+template <int SYMBOL_BITS>
+inline SymbolType neuralink_16bit_to_symbol(int16_t x) {
+    return static_cast<SymbolType>((x >> (16 - SYMBOL_BITS)) + (1 << (SYMBOL_BITS - 1)));
+}
+
+template <>
+inline SymbolType neuralink_16bit_to_symbol<10>(int16_t x) {
+    return neuralink_16bit_to_10bit(x);
+}
+
+
+/**
+ * @brief Converts an unsigned SYMBOL_BITS value back to a signed 16-bit value.
+ *
+ * The discarded low bits are zero, as in the left-aligned samples of a SYMBOL_BITS converter,
+ * which therefore round trip losslessly. The 10-bit conversion is neuralink_10bit_to_16bit,
+ * with the reconstruction of the Neuralink data.
+ */
+template <int SYMBOL_BITS>
+inline int16_t neuralink_symbol_to_16bit(SymbolType u) {
+    const int32_t offset = static_cast<int32_t>(u & ((1u << SYMBOL_BITS) - 1)) - (1 << (SYMBOL_BITS - 1));
+    return static_cast<int16_t>(offset * (1 << (16 - SYMBOL_BITS)));
+}
+
+template <>
+inline int16_t neuralink_symbol_to_16bit<10>(SymbolType u) {
+    return neuralink_10bit_to_16bit(u);
+}
+
+
+/**
+ * @brief Converts a span of signed 16-bit samples to SYMBOL_BITS symbols.
+ *
+ * The 10-bit conversion uses the vectorized neuralink_16bit_to_10bit.
+ */
+template <int SYMBOL_BITS>
+inline void neuralink_16bit_to_symbols(const int16_t *samples, SymbolType *symbols, size_t count) {
+    if (SYMBOL_BITS == 10) {
+        neuralink_16bit_to_10bit(samples, symbols, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        symbols[i] = neuralink_16bit_to_symbol<SYMBOL_BITS>(samples[i]);
+    }
+}
+
+
+/**
+ * @brief Converts a span of SYMBOL_BITS symbols back to signed 16-bit samples.
+ *
+ * The 10-bit conversion uses the vectorized neuralink_10bit_to_16bit.
+ */
+template <int SYMBOL_BITS>
+inline void neuralink_symbols_to_16bit(const SymbolType *symbols, int16_t *samples, size_t count) {
+    if (SYMBOL_BITS == 10) {
+        neuralink_10bit_to_16bit(symbols, samples, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        samples[i] = neuralink_symbol_to_16bit<SYMBOL_BITS>(symbols[i]);
+    }
+}
+
+
 /**
  * @brief Reads a 16-bit raw sample from the input stream and converts it to a 10-bit symbol.
  * 
@@ -74,7 +407,7 @@ int16_t neuralink_10bit_to_16bit(SymbolType u) {
  * @return Returns `true` if the read operation was successful and the symbol was converted and stored.
  *         Returns `false` if the end of the stream is reached or if a read error occurs.
  */
-bool neuralink_read_symbol_from_stream(std::istream &inputStream, SymbolType &symbol) {
+inline bool neuralink_read_symbol_from_stream(std::istream &inputStream, SymbolType &symbol) {
     int16_t raw_sample;
     if (inputStream.read(reinterpret_cast<char*>(&raw_sample), sizeof(raw_sample))) {
         symbol = neuralink_16bit_to_10bit(raw_sample);
@@ -84,6 +417,20 @@ bool neuralink_read_symbol_from_stream(std::istream &inputStream, SymbolType &sy
 }
 
 
+/**
+ * @brief Reads up to `count` 16-bit raw samples from the input stream in one bulk read.
+ *
+ * @param inputStream The input stream from which the raw samples are read.
+ * @param samples Receives the raw samples.
+ * @param count The maximum number of samples to read.
+ * @return The number of complete samples read, 0 at the end of the stream.
+ */
+inline size_t neuralink_read_samples_from_stream(std::istream &inputStream, int16_t *samples, size_t count) {
+    inputStream.read(reinterpret_cast<char*>(samples), count * sizeof(int16_t));
+    return static_cast<size_t>(inputStream.gcount()) / sizeof(int16_t);
+}
+
+
 /**
  * @brief Converts a 10-bit symbol to a 16-bit raw sample and writes it to the output stream.
  * 
@@ -94,7 +441,7 @@ bool neuralink_read_symbol_from_stream(std::istream &inputStream, SymbolType &sy
  * @param symbol The 10-bit symbol to be converted and written to the stream.
  * @return Returns a reference to the output stream after the write operation.
  */
-std::ostream &neuralink_write_symbol_to_stream(std::ostream &outputStream, uint16_t &symbol) {
+inline std::ostream &neuralink_write_symbol_to_stream(std::ostream &outputStream, uint16_t &symbol) {
     int16_t raw_sample;
     raw_sample = neuralink_10bit_to_16bit(symbol);
     return outputStream.write(reinterpret_cast<char*>(&raw_sample), sizeof(raw_sample));
@@ -102,30 +449,40 @@ std::ostream &neuralink_write_symbol_to_stream(std::ostream &outputStream, uint1
 
 
 /**
- * @brief Checks the WAV file header to ensure it is a 16-bit mono format.
+ * @brief Checks the WAV file header to ensure it is a 16-bit format.
  * 
  * This function verifies that the provided WAV file header is of the correct size (44 bytes)
- * and that it represents a 16-bit mono WAV file. If the header does not meet these criteria,
+ * and that it represents a 16-bit WAV file. If the header does not meet these criteria,
  * the function throws a runtime error.
  * 
  * @param header A vector of bytes representing the WAV file header.
- * @throws std::runtime_error if the header size is not 44 bytes or if the WAV format is not 16-bit mono.
+ * @return The number of interleaved channels, 1 for the mono competition data.
+ * @throws std::runtime_error if the header size is not 44 bytes or if the WAV format is not 16-bit.
  */
-void neuralink_check_wav_header(const std::vector<uint8_t> &header) {
+inline uint16_t neuralink_check_wav_header(const std::vector<uint8_t> &header) {
     if (header.size() != 44) {
         throw std::runtime_error("Invalid WAV header size");
     }
     uint16_t numChannels = *reinterpret_cast<const uint16_t*>(&header[22]);
     uint16_t bitsPerSample = *reinterpret_cast<const uint16_t*>(&header[34]);
 
-    // Verify that this is a 16-bit mono WAV file
-    if (numChannels != 1 || bitsPerSample != 16) {
-        throw std::runtime_error("Unsupported WAV format, we only support 16 bit mono WAV data");
+    // Verify that this is a 16-bit WAV file
+    if (numChannels == 0 || bitsPerSample != 16) {
+        throw std::runtime_error("Unsupported WAV format, we only support 16 bit WAV data");
     }
+    return numChannels;
+}
+
+
+/**
+ * @brief Returns the number of bits needed to represent x.
+ */
+constexpr int bit_width(uint32_t x) {
+    return x == 0 ? 0 : 1 + bit_width(x >> 1);
 }
 
 
-double normal_cdf(double x, double loc, double scale) {
+inline double normal_cdf(double x, double loc, double scale) {
     // Standardize the input
     double standardized_x = (x - loc) / scale;
     
@@ -134,82 +491,462 @@ double normal_cdf(double x, double loc, double scale) {
 }
 
 
-class Model {
+/**
+ * @brief The compile-time shape of a model: the symbol bit depth and the number of distributions.
+ *
+ * The alphabet, the stop symbol and the center of the distributions follow from the bit depth.
+ * The models and their parameters take the layout as a template argument, so that every layout
+ * gets code with its own table sizes and constant loop counts.
+ *
+ * Without a stop symbol the alphabet is exactly 2^SYMBOL_BITS, so the symbol shift wraps with a
+ * mask instead of a modulo, and the stream length has to be known from elsewhere, see
+ * BrainwireHeader::stop_symbol.
+ *
+ * @tparam BITS The bits per symbol, the Neuralink data has 10.
+ * @tparam DISTRIBUTIONS The number of conditional symbol distributions.
+ * @tparam STOP True if the alphabet contains the stop symbol that ends a stream.
+ */
+template <int BITS, uint16_t DISTRIBUTIONS, bool STOP = true>
+struct ModelLayout {
+    static constexpr int SYMBOL_BITS = BITS;
+    static constexpr uint16_t NUM_DIST = DISTRIBUTIONS;
+    static constexpr bool HAS_STOP = STOP;
+
+    // the 2^SYMBOL_BITS symbols of the signal and 1 extra "STOP" symbol, if any
+    static constexpr SymbolType NUM_SYMBOLS = (1u << SYMBOL_BITS) + (HAS_STOP ? 1 : 0);
+    static constexpr SymbolType STOP_SYMBOL = 1u << SYMBOL_BITS;
+
+    // the symbol the distributions are centered on before the symbol shift
+    static constexpr SymbolType CENTER = (1u << (SYMBOL_BITS - 1)) - 1;
+
+    // the alphabet has to fit in the smallest frequency total of a 17 bit coder, and the
+    // parameters in the 255 values of the stream header
+    static_assert(SYMBOL_BITS >= 2 && SYMBOL_BITS <= 14, "Unsupported symbol bits");
+    static_assert(NUM_DIST >= 1 && 6 + 4 * NUM_DIST <= 255, "Unsupported number of distributions");
+};
+
+// The layout of the 10 bit Neuralink data with 4 distributions
+typedef ModelLayout<10, 4> NeuralinkLayout;
+
+// The Neuralink layout with exactly 1024 symbols, for streams whose length is known
+typedef ModelLayout<10, 4, false> NeuralinkStoplessLayout;
+
+
+/**
+ * @brief The constants of the dynamic state model and of the conditional distributions.
+ *
+ * The defaults of NeuralinkLayout were experimentally recovered from example data. Other
+ * layouts start from them, interpolated over NUM_DIST distributions and with the deviations
+ * scaled to the symbol bit depth, and are meant to be fitted by tune.
+ *
+ * @tparam Layout The ModelLayout of the model.
+ */
+template <typename Layout>
+struct BasicModelParameters {
+    // Number of conditional symbol distributions
+    static const uint16_t NUM_DIST = Layout::NUM_DIST;
+
+    // the symbol scale of the layout relative to the 10 bit defaults
+    static constexpr double SCALE = static_cast<double>(1u << (Layout::SYMBOL_BITS > 10 ? Layout::SYMBOL_BITS - 10 : 0)) /
+                                    static_cast<double>(1u << (Layout::SYMBOL_BITS < 10 ? 10 - Layout::SYMBOL_BITS : 0));
+
+    // Dynamic state model
+    double ma = 0.20;
+    double ltv = 7.5 * SCALE * SCALE;
+    double alpha = 0.725;
+    double beta  = 0.175;
+    double outlier_level = 8.4;
+    double mrr = 0.05;
+
+    // conditional distribution constants
+    std::array<double, NUM_DIST> std_levels;
+    std::array<double, NUM_DIST> cdf_scale;
+    std::array<double, NUM_DIST> cdf_w;
+    std::array<double, NUM_DIST> cdf_z;
+
+    BasicModelParameters() {
+        static const double levels[4] = {16, 18, 20, 22};
+        static const double scales[4] = {5.145, 6.035, 8.547, 20.05};
+        static const double z[4] = {106.3, 82.84, 62.87, 61.86};
+        for (int i = 0; i < NUM_DIST; ++i) {
+            const double x = NUM_DIST > 1 ? 3.0 * i / (NUM_DIST - 1) : 0.0;
+            std_levels[i] = interpolate(levels, x) * SCALE;
+            cdf_scale[i] = interpolate(scales, x) * SCALE;
+            cdf_w[i] = 2.5E-4;
+            cdf_z[i] = interpolate(z, x) * (Layout::NUM_SYMBOLS / 1025.0);
+        }
+    }
+
+    // Number of values, in the order of values()
+    static constexpr size_t NUM_VALUES = 6 + 4 * NUM_DIST;
+
+    /**
+     * @brief All constants as a flat list, the state model constants followed by the arrays.
+     */
+    std::vector<double> values() const {
+        std::vector<double> v = {ma, ltv, alpha, beta, outlier_level, mrr};
+        for (const std::array<double, NUM_DIST> *a : {&std_levels, &cdf_scale, &cdf_w, &cdf_z}) {
+            v.insert(v.end(), a->begin(), a->end());
+        }
+        return v;
+    }
+
+    /**
+     * @brief Sets all constants from a list in the order of values().
+     *
+     * @throws std::runtime_error if the list has the wrong size or the constants are not valid().
+     */
+    void set_values(const std::vector<double> &v) {
+        if (v.size() != NUM_VALUES) {
+            throw std::runtime_error("Invalid number of model parameters");
+        }
+        BasicModelParameters p;
+        size_t i = 0;
+        for (double *x : {&p.ma, &p.ltv, &p.alpha, &p.beta, &p.outlier_level, &p.mrr}) {
+            *x = v[i++];
+        }
+        for (std::array<double, NUM_DIST> *a : {&p.std_levels, &p.cdf_scale, &p.cdf_w, &p.cdf_z}) {
+            for (double &x : *a) {
+                x = v[i++];
+            }
+        }
+        if (!p.valid()) {
+            throw std::runtime_error("Invalid model parameters");
+        }
+        *this = p;
+    }
+
+    /**
+     * @brief Returns true if the constants define a stable state model and valid distributions.
+     */
+    bool valid() const {
+        bool ok = ma >= 0 && ma < 1 && ltv > 0 && alpha >= 0 && beta >= 0 && alpha + beta < 1 &&
+                  outlier_level > 0 && mrr >= 0 && mrr <= 1;
+        for (int i = 0; i < NUM_DIST; ++i) {
+            ok = ok && std_levels[i] > 0 && (i == 0 || std_levels[i] > std_levels[i - 1]);
+            ok = ok && cdf_scale[i] > 0 && cdf_w[i] >= 0 && cdf_z[i] >= 0;
+            ok = ok && cdf_w[i] + cdf_z[i] / Layout::NUM_SYMBOLS < 1;
+        }
+        return ok;
+    }
+
+private:
+    // the 4 default values at a fractional index, exact at the integer indices
+    static double interpolate(const double (&a)[4], double x) {
+        const int j = static_cast<int>(x);
+        if (j >= 3) {
+            return a[3];
+        }
+        return a[j] + (x - j) * (a[j + 1] - a[j]);
+    }
+};
+
+// The parameters of the Neuralink layout
+typedef BasicModelParameters<NeuralinkLayout> ModelParameters;
+
+
+/**
+ * @brief Writes the model parameters as text, one named constant or array per line.
+ */
+template <typename Layout>
+void write_model_parameters(std::ostream &out, const BasicModelParameters<Layout> &params) {
+    static const char *names[] = {"ma", "ltv", "alpha", "beta", "outlier_level", "mrr"};
+    static const char *array_names[] = {"std_levels", "cdf_scale", "cdf_w", "cdf_z"};
+    const std::vector<double> v = params.values();
+
+    out << std::setprecision(17);
+    size_t i = 0;
+    for (const char *name : names) {
+        out << name << " " << v[i++] << "\n";
+    }
+    for (const char *name : array_names) {
+        out << name;
+        for (int j = 0; j < params.NUM_DIST; ++j) {
+            out << " " << v[i++];
+        }
+        out << "\n";
+    }
+}
+
+
+/**
+ * @brief Reads model parameters written by write_model_parameters.
+ *
+ * Constants that are not in the text keep their default value. Empty lines and lines
+ * starting with # are ignored.
+ *
+ * @tparam P The parameters type, the parameters of the Neuralink layout by default.
+ * @throws std::runtime_error on unknown names, malformed values or invalid parameters.
+ */
+template <typename P = ModelParameters>
+P read_model_parameters(std::istream &in) {
+    static const char *names[] = {
+        "ma", "ltv", "alpha", "beta", "outlier_level", "mrr", "std_levels", "cdf_scale", "cdf_w", "cdf_z"
+    };
+    P params;
+    std::vector<double> v = params.values();
+
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string name;
+        if (!(fields >> name) || name[0] == '#') {
+            continue;
+        }
+        size_t offset = 0;
+        size_t count = 0;
+        for (size_t k = 0; k < 10; ++k) {
+            count = k < 6 ? 1 : P::NUM_DIST;
+            if (name == names[k]) {
+                break;
+            }
+            offset += count;
+        }
+        if (offset == P::NUM_VALUES) {
+            throw std::runtime_error("Unknown model parameter: " + name);
+        }
+        for (size_t j = 0; j < count; ++j) {
+            if (!(fields >> v[offset + j])) {
+                throw std::runtime_error("Malformed model parameter: " + name);
+            }
+        }
+    }
+    params.set_values(v);
+    return params;
+}
+
+
+/**
+ * @brief Compile-time ccft tables for the default ModelParameters of NeuralinkLayout.
+ *
+ * The generated ccft_tables.hpp specializes this for the frequency totals it contains, with
+ * the NUM_DIST rows of NUM_SYMBOLS + 1 entries flattened into a single array. Tables for other
+ * totals are computed at runtime.
+ */
+template <uint32_t TOTAL_FREQUENCY>
+struct PrecomputedCcft {
+    static constexpr size_t SIZE = 0;
+    static const uint16_t* table() { return nullptr; }
+};
+
+#include "ccft_tables.hpp"
+
+/**
+ * @brief True if a frequency total gives every symbol of a layout a range in BasicModel.
+ *
+ * Lets the dispatch over stream header fields skip the model types that do not compile.
+ */
+template <uint32_t TOTAL_FREQUENCY, typename Layout>
+struct ModelSupports : std::integral_constant<bool, (TOTAL_FREQUENCY > Layout::NUM_SYMBOLS && TOTAL_FREQUENCY <= 0x8000)> {};
+
+// the states of many channels in SoA arrays, see batch.hpp
+template <uint32_t TOTAL_FREQUENCY>
+class BasicModelBatch;
+
+
+/**
+ * @brief Dynamic predictive probability model of the next symbol.
+ *
+ * @tparam TOTAL_FREQUENCY The total of the cumulative frequency tables, which is the divisor
+ *         when the coders scale their range. The original model uses 2^15 - 1, a power of two
+ *         turns these divisions into shifts.
+ * @tparam LAYOUT The ModelLayout, the 10 bit symbols and 4 distributions of the Neuralink data
+ *         by default.
+ */
+template <uint32_t TOTAL_FREQUENCY, typename LAYOUT = NeuralinkLayout>
+class BasicModel {
 public:
     // type aliases
     using SymbolType = uint16_t;
     using FrequencyType = uint16_t;
     using IntType = uint32_t;
+    using Layout = LAYOUT;
+    using Parameters = BasicModelParameters<Layout>;
 
-    // we have a 10 bits signal with 1024 possible symbols 0,1,...,1023. 
-    // Additionally we add 1 extra "STOP" symbol with id 1024
-    static constexpr SymbolType NUM_SYMBOLS = 1025; // 1024 for the 10bit signal + 1 extra stop symbol
+    // the 2^SYMBOL_BITS symbols 0,1,...,2^SYMBOL_BITS - 1 of the signal
+    // and 1 extra "STOP" symbol with id 2^SYMBOL_BITS, if HAS_STOP
+    static constexpr int SYMBOL_BITS = Layout::SYMBOL_BITS;
+    static constexpr bool HAS_STOP = Layout::HAS_STOP;
+    static constexpr SymbolType NUM_SYMBOLS = Layout::NUM_SYMBOLS;
+    static constexpr SymbolType STOP_SYMBOL = Layout::STOP_SYMBOL;
+
+    // Number of conditional symbol distributions
+    static const uint16_t NUM_DIST = Layout::NUM_DIST;
 
     // 
-    static constexpr FrequencyType MAX_FREQUENCY = 0x7FFF; // 2^15 - 1
-    static constexpr IntType MAX_CODE = 0x1FFFF; // 2^17 - 1
-    static constexpr IntType Int25 = 0x8000; // 2^17 * 1/4 = 2^15
-    static constexpr IntType Int50 = 0x10000; // 2^17 * 1/2 = 2^16
-    static constexpr IntType Int75 = 0x18000; // 2^17 * 3/4 = 2^16 + 2^15
+    static constexpr FrequencyType MAX_FREQUENCY = TOTAL_FREQUENCY;
+    static constexpr int CODE_BITS = 17;
+    static constexpr IntType MAX_CODE = (IntType(1) << CODE_BITS) - 1;
+    static constexpr IntType Int25 = IntType(1) << (CODE_BITS - 2); // 2^17 * 1/4 = 2^15
+    static constexpr IntType Int50 = IntType(1) << (CODE_BITS - 1); // 2^17 * 1/2 = 2^16
+    static constexpr IntType Int75 = Int25 + Int50; // 2^17 * 3/4 = 2^16 + 2^15
+
+    // every symbol needs a non-empty range in the smallest renormalized arithmetic coder range
+    static_assert(TOTAL_FREQUENCY > NUM_SYMBOLS && TOTAL_FREQUENCY <= Int25, "Unsupported total frequency");
+
+    // Reverse lookup from frequency buckets of 2^LOOKUP_SHIFT to the first symbol in each bucket
+    static constexpr int LOOKUP_BITS = 11;
+    static constexpr int LOOKUP_SHIFT = bit_width(MAX_FREQUENCY - 1) > LOOKUP_BITS ? bit_width(MAX_FREQUENCY - 1) - LOOKUP_BITS : 0;
+    static constexpr uint32_t LOOKUP_SIZE = ((MAX_FREQUENCY - 1) >> LOOKUP_SHIFT) + 1;
+
+    // the compile-time tables are of the Neuralink layout, PrecomputedCcft<0> has none
+    using Precomputed = PrecomputedCcft<std::is_same<Layout, NeuralinkLayout>::value ? TOTAL_FREQUENCY : 0>;
+    static_assert(
+        Precomputed::SIZE == 0 ||
+        Precomputed::SIZE == NUM_DIST * (NUM_SYMBOLS + 1),
+        "ccft_tables.hpp is out of date, run make tables"
+    );
+
+    /**
+     * @brief The immutable frequency tables, shared by all models with the same parameters.
+     */
+    struct Tables {
+        // Conditional Cummulative Frequency Table (ccft)
+        std::array<std::array<FrequencyType, NUM_SYMBOLS + 1>, NUM_DIST> ccft;
+
+        // reverse lookup of ccft
+        std::array<std::array<SymbolType, LOOKUP_SIZE>, NUM_DIST> ccft_lookup;
+    };
 
 
     // Constructor
-    Model()
+    BasicModel() : BasicModel(Parameters(), default_tables()) {}
+
+    /**
+     * @brief A model with other constants, the tables must be built from the same parameters.
+     *
+     * @param parameters The model constants.
+     * @param model_tables The tables, see make_tables. They are not copied and must outlive the model.
+     */
+    BasicModel(const Parameters &parameters, const Tables &model_tables)
+        : params(parameters)
     {
-        omega =  ltv / (1 - alpha - beta);
+        omega =  params.ltv / (1 - params.alpha - params.beta);
+        for (int i = 0; i < NUM_DIST; ++i) {
+            ccft_rows[i] = model_tables.ccft[i].data();
+            lookup_rows[i] = model_tables.ccft_lookup[i].data();
+        }
+    }
+
 
-        // fill the ccft
+    /**
+     * @brief Computes the ccft part of the tables from the distribution parameters.
+     *
+     * This is the definition of the tables, the compile-time tables must match it exactly.
+     */
+    static void compute_ccft(const Parameters &params, Tables &t) {
         for (int i=0; i<NUM_DIST; ++i) {
 
             double max_p = cdf(
                 NUM_SYMBOLS,  
-                511.0, 
-                cdf_scale[i], 
-                cdf_w[i], 
-                static_cast<double>(cdf_z[i]) /  Model::NUM_SYMBOLS
+                static_cast<double>(Layout::CENTER), 
+                params.cdf_scale[i], 
+                params.cdf_w[i], 
+                static_cast<double>(params.cdf_z[i]) / NUM_SYMBOLS
             );
 
             for (int j=1; j < NUM_SYMBOLS; ++j) {
                 double p = cdf(
                     j, 
-                    511.0, 
-                    cdf_scale[i], 
-                    cdf_w[i],
-                    static_cast<double>(cdf_z[i]) /  Model::NUM_SYMBOLS
+                    static_cast<double>(Layout::CENTER), 
+                    params.cdf_scale[i], 
+                    params.cdf_w[i],
+                    static_cast<double>(params.cdf_z[i]) / NUM_SYMBOLS
                 );
-                ccft[i][j] = static_cast<FrequencyType>(p / max_p * (MAX_FREQUENCY - NUM_SYMBOLS)) + j;
+                t.ccft[i][j] = static_cast<FrequencyType>(p / max_p * (MAX_FREQUENCY - NUM_SYMBOLS)) + j;
             }          
-            ccft[i][0] = 0;
-            ccft[i][NUM_SYMBOLS] = MAX_FREQUENCY;
+            t.ccft[i][0] = 0;
+            t.ccft[i][NUM_SYMBOLS] = MAX_FREQUENCY;
+        }
+    }
+
+
+    /**
+     * @brief Fills the reverse lookup part of the tables from the ccft.
+     */
+    static void compute_lookup(Tables &t) {
+        for (int i=0; i<NUM_DIST; ++i) {
+            compute_lookup(t.ccft[i].data(), t.ccft_lookup[i].data());
+        }
+    }
+
+    /**
+     * @brief Fills the LOOKUP_SIZE reverse lookup row of a ccft row.
+     */
+    static void compute_lookup(const FrequencyType *ccft, SymbolType *lookup) {
+        // the last symbol that starts at or before each bucket
+        uint32_t loc = 0;
+        for (uint32_t b = 0; b < LOOKUP_SIZE; ++b) {
+            while (ccft[loc + 1] <= (b << LOOKUP_SHIFT)) {
+                loc++;
+            }
+            lookup[b] = static_cast<SymbolType>(loc);
         }
     }
 
+
+    /**
+     * @brief Builds the tables of a set of parameters at runtime.
+     */
+    static Tables make_tables(const Parameters &params) {
+        Tables t;
+        compute_ccft(params, t);
+        compute_lookup(t);
+        return t;
+    }
+
+    /**
+     * @brief The tables of the default parameters, built once per process.
+     *
+     * The ccft comes from ccft_tables.hpp if it contains this frequency total and layout.
+     */
+    static const Tables &default_tables() {
+        static const Tables instance = make_default_tables();
+        return instance;
+    }
+
     void symbol_low_high(const SymbolType symbol, FrequencyType &low, FrequencyType &high) const {
+        row_low_high(ccft_rows[active_dist], active_symbol_shift, symbol, low, high);
+    };
+
+    SymbolType frequency_symbol(FrequencyType freq) const {
+        return row_symbol(ccft_rows[active_dist], lookup_rows[active_dist], active_symbol_shift, freq);
+    };
+
+    /**
+     * @brief The [low, high) range of a symbol in a ccft row, with the symbol shift of a state.
+     */
+    static void row_low_high(const FrequencyType *row, int16_t shift, const SymbolType symbol, FrequencyType &low, FrequencyType &high) {
         IntType loc = symbol;
         loc += NUM_SYMBOLS;
-        loc += active_symbol_shift;
+        loc += shift;
         loc = loc % NUM_SYMBOLS;
 
-        low = ccft[active_dist][loc];
-        high = ccft[active_dist][loc + 1];
-    };
+        low = row[loc];
+        high = row[loc + 1];
+    }
 
-    SymbolType frequency_symbol(const FrequencyType freq) const {
-        SymbolType loc;
+    /**
+     * @brief The symbol whose range in a ccft row contains freq, the inverse of row_low_high.
+     */
+    static SymbolType row_symbol(const FrequencyType *table, const SymbolType *lookup, int16_t shift, FrequencyType freq) {
+        if (freq >= MAX_FREQUENCY) {
+            freq = MAX_FREQUENCY - 1;
+        }
 
-        auto it = std::upper_bound(ccft[active_dist].begin(), ccft[active_dist].end(), freq);
-        if (it == ccft[active_dist].begin()) {
-            loc = 0;
-        } else {
-            loc = std::distance(ccft[active_dist].begin(), it) - 1;
+        // start at the first symbol of the frequency bucket and step to the symbol
+        // whose [low, high) range contains freq
+        uint32_t loc = lookup[freq >> LOOKUP_SHIFT];
+        while (table[loc + 1] <= freq) {
+            loc++;
         }
 
         SymbolType symbol = static_cast<SymbolType>(
-            static_cast<uint32_t>(loc + NUM_SYMBOLS - active_symbol_shift) % NUM_SYMBOLS
+            static_cast<uint32_t>(loc + NUM_SYMBOLS - shift) % NUM_SYMBOLS
         );
 
         return symbol;
-    };
+    }
 
 
 
@@ -217,7 +954,7 @@ public:
         double ds = symbol - mean;
 
         // outlier filter
-        if (std::abs(ds) > outlier_level * stdev) {
+        if (std::abs(ds) > params.outlier_level * stdev) {
             outlier_counter++;
         } else {
             outlier_counter = 0;
@@ -228,59 +965,593 @@ public:
 
         // update mean & std
         if (outlier_counter == 0) {
-            mean = ma * mean + (1-ma) * symbol;
-            stdev = std::sqrt(omega + alpha * stdev * stdev + beta * ds * ds);
+            mean = params.ma * mean + (1-params.ma) * symbol;
+            stdev = std::sqrt(omega + params.alpha * stdev * stdev + params.beta * ds * ds);
 
             active_dist = std::distance(
-                std_levels.begin(),
-                std::lower_bound(std_levels.begin(), std_levels.end(), stdev)
+                params.std_levels.begin(),
+                std::lower_bound(params.std_levels.begin(), params.std_levels.end(), stdev)
             );
-            active_dist = std::min<uint16_t>(active_dist, Model::NUM_DIST - 1);
+            active_dist = std::min<uint16_t>(active_dist, NUM_DIST - 1);
 
             //
-            active_symbol_shift = 511 - static_cast<SymbolType>(mean + (symbol - mean)*mrr);
+            active_symbol_shift = Layout::CENTER - static_cast<SymbolType>(mean + (symbol - mean)*params.mrr);
 
         }
     };
 
-private: 
-    // Number of conditional symbol distributions
-    static const uint16_t NUM_DIST = 4; 
+    /**
+     * @brief The index of the conditional distribution used for the next symbol.
+     */
+    uint16_t distribution() const {
+        return active_dist;
+    }
+
+    /**
+     * @brief Returns true if the outlier filter skipped the state update for the last symbol.
+     */
+    bool outlier() const {
+        return outlier_counter > 0;
+    }
 
-    // Conditional Cummulative Frequency Table (ccft)
-    std::array<std::array<FrequencyType, Model::NUM_SYMBOLS + 1>, Model::NUM_DIST> ccft;
+    /**
+     * @brief Saves the dynamic state, see checkpoint.hpp.
+     */
+    void save(CheckpointWriter &writer) const {
+        writer.put(active_dist, 2);
+        writer.put(static_cast<uint16_t>(active_symbol_shift), 2);
+        writer.put_double(mean);
+        writer.put_double(stdev);
+        writer.put(outlier_counter, 2);
+    }
+
+    /**
+     * @brief Restores the dynamic state into a model with the parameters of the saved model.
+     *
+     * @throws std::runtime_error if the checkpoint is truncated or invalid.
+     */
+    void restore(CheckpointReader &reader) {
+        active_dist = static_cast<uint16_t>(reader.get(2));
+        active_symbol_shift = static_cast<int16_t>(reader.get(2));
+        mean = reader.get_double();
+        stdev = reader.get_double();
+        outlier_counter = static_cast<uint16_t>(reader.get(2));
+        if (active_dist >= NUM_DIST || outlier_counter > 3 || !std::isfinite(mean) || !std::isfinite(stdev)) {
+            throw std::runtime_error("Invalid model checkpoint");
+        }
+    }
+
+protected:
+    friend class BasicModelBatch<TOTAL_FREQUENCY>;
+
+    // the ccft and reverse lookup row of every distribution, derived models may use rows of their own
+    std::array<const FrequencyType*, NUM_DIST> ccft_rows;
+    std::array<const SymbolType*, NUM_DIST> lookup_rows;
+    Parameters params;
 
     // index of the current distribution
     uint16_t active_dist = 0;
     int16_t active_symbol_shift = 0;
 
     // Dynamic state model
-    double mean  = 511;
-    double stdev = 8.0;
-    double ma = 0.20;
-    double ltv = 7.5;
-    double alpha = 0.725;
-    double beta  = 0.175;
-    double outlier_level = 8.4;
-    double mrr = 0.05;
+    double mean  = Layout::CENTER;
+    double stdev = 8.0 * Parameters::SCALE;
     double omega ;
     uint16_t outlier_counter = 0;
 
-    // conditional distribution constants
-    std::array<double, NUM_DIST> std_levels = {16, 18, 20, 22};
-    std::array<double, NUM_DIST> cdf_scale = {5.145, 6.035, 8.547, 20.05};
-    std::array<double, NUM_DIST> cdf_w = {2.5E-4, 2.5E-4,  2.5E-4, 2.5E-4};
-    std::array<double, NUM_DIST> cdf_z = {106.3, 82.84, 62.87, 61.86} ;
-
 
-    double cdf(double x, double loc, double scale, double w, double z) {
+private:
+    static double cdf(double x, double loc, double scale, double w, double z) {
         double p = (1.0 - w - z) * normal_cdf(x, loc, scale) + w;
         if (x >= loc) {
             p += z;
         }
         return p;
     }    
+
+    static Tables make_default_tables() {
+        const uint16_t *precomputed = Precomputed::table();
+        if (!precomputed) {
+            return make_tables(Parameters());
+        }
+        Tables t;
+        for (int i=0; i<NUM_DIST; ++i) {
+            std::copy(precomputed + i * (NUM_SYMBOLS + 1), precomputed + (i + 1) * (NUM_SYMBOLS + 1), t.ccft[i].begin());
+        }
+        compute_lookup(t);
+        return t;
+    }
 };
 
 
+/**
+ * @brief Model variant with a fixed-point mean and variance recursion.
+ *
+ * Uses the same tables and conditional distributions as BasicModel, but tracks the mean and
+ * the squared stdev as 64 bit integers with 16 fractional bits. The outlier filter and the
+ * distribution selection compare squared values, so update_state needs no floating point
+ * arithmetic and no square root, and the encoder and decoder agree bit-for-bit on any
+ * platform. The parameters are converted to fixed point once, at construction.
+ */
+template <uint32_t TOTAL_FREQUENCY, typename LAYOUT = NeuralinkLayout>
+class BasicFixedPointModel : public BasicModel<TOTAL_FREQUENCY, LAYOUT> {
+    using Base = BasicModel<TOTAL_FREQUENCY, LAYOUT>;
+
+public:
+    using typename Base::SymbolType;
+    using typename Base::Layout;
+    using typename Base::Parameters;
+    static const uint16_t NUM_DIST = Base::NUM_DIST;
+
+    // number of fractional bits of the fixed-point state
+    static constexpr int FRACTION_BITS = 16;
+    static constexpr int64_t ONE = int64_t(1) << FRACTION_BITS;
+
+    using typename Base::Tables;
+
+    BasicFixedPointModel() : BasicFixedPointModel(Parameters(), Base::default_tables()) {}
+
+    BasicFixedPointModel(const Parameters &parameters, const Tables &model_tables)
+        : Base(parameters, model_tables)
+    {
+        const Parameters &p = this->params;
+        ma = to_fixed(p.ma);
+        alpha = to_fixed(p.alpha);
+        beta = to_fixed(p.beta);
+        mrr = to_fixed(p.mrr);
+        omega = to_fixed(Base::omega);
+        outlier_level_squared = to_fixed(p.outlier_level * p.outlier_level);
+        for (int i = 0; i < NUM_DIST; ++i) {
+            std_levels_squared[i] = to_fixed(p.std_levels[i] * p.std_levels[i]);
+        }
+        mean = to_fixed(Base::mean);
+        variance = to_fixed(Base::stdev * Base::stdev);
+    }
+
+    void update_state(SymbolType symbol) {
+        const int64_t x = static_cast<int64_t>(symbol) << FRACTION_BITS;
+        const int64_t ds = x - mean;
+        const int64_t ds_squared = (ds * ds) >> FRACTION_BITS;
+
+        // outlier filter, |ds| > outlier_level * stdev compared as squares
+        if (ds_squared > ((outlier_level_squared * variance) >> FRACTION_BITS)) {
+            this->outlier_counter++;
+        } else {
+            this->outlier_counter = 0;
+        }
+        if (this->outlier_counter > 3) {
+            this->outlier_counter = 0;
+        }
+
+        // update mean & variance
+        if (this->outlier_counter == 0) {
+            mean = (ma * mean + (ONE - ma) * x) >> FRACTION_BITS;
+            variance = omega + ((alpha * variance + beta * ds_squared) >> FRACTION_BITS);
+
+            // the number of std_levels below stdev, at most NUM_DIST - 1
+            uint16_t dist = 0;
+            for (int i = 0; i < NUM_DIST - 1; ++i) {
+                dist += variance > std_levels_squared[i];
+            }
+            this->active_dist = dist;
+
+            const int64_t shifted = mean + ((mrr * (x - mean)) >> FRACTION_BITS);
+            this->active_symbol_shift = Layout::CENTER - static_cast<SymbolType>(shifted >> FRACTION_BITS);
+        }
+    }
+
+    void save(CheckpointWriter &writer) const {
+        Base::save(writer);
+        writer.put(static_cast<uint64_t>(mean), 8);
+        writer.put(static_cast<uint64_t>(variance), 8);
+    }
+
+    void restore(CheckpointReader &reader) {
+        Base::restore(reader);
+        mean = static_cast<int64_t>(reader.get(8));
+        variance = static_cast<int64_t>(reader.get(8));
+        // the products of update_state stay within 64 bits
+        const int64_t max_variance = INT64_MAX / std::max(std::max(outlier_level_squared, alpha), int64_t(ONE));
+        if (mean < 0 || mean > (static_cast<int64_t>(Base::NUM_SYMBOLS) << FRACTION_BITS) ||
+            variance < 0 || variance > max_variance) {
+            throw std::runtime_error("Invalid model checkpoint");
+        }
+    }
+
+private:
+    // parameters
+    int64_t ma;
+    int64_t alpha;
+    int64_t beta;
+    int64_t mrr;
+    int64_t omega;
+    int64_t outlier_level_squared;
+    std::array<int64_t, NUM_DIST> std_levels_squared;
+
+    // Dynamic state model
+    int64_t mean;
+    int64_t variance;
+
+    static int64_t to_fixed(double x) {
+        return static_cast<int64_t>(std::llround(x * ONE));
+    }
+};
+
+
+/**
+ * @brief Model variant whose frequency tables adapt to the recording.
+ *
+ * Uses the state model of BasicModel to select the distribution and the symbol shift, and
+ * counts every coded symbol at its shifted position in the selected distribution. Every
+ * REBUILD_INTERVAL symbols of a distribution its ccft row and reverse lookup are rebuilt from
+ * the counts, so the cost of the adaptation is amortized to a few operations per symbol. The
+ * static tables are the initial counts, and the counts are halved when they exceed
+ * COUNT_LIMIT, so that the tables follow slow changes of the signal. The rebuild uses integer
+ * arithmetic only, the encoder and decoder rebuild at the same symbols and stay in sync.
+ *
+ * The rows are copied on write: a distribution codes with the shared static row and only logs
+ * the positions of its symbols until its first rebuild, which gives it a row and counts of its
+ * own. Recordings rarely use all distributions, so a model holds fewer rows than NUM_DIST.
+ * The reverse lookup of a row is only built when the decoder searches it, so encoders do
+ * without. The memory per channel is what limits the number of channels that fit in the
+ * caches of one core.
+ */
+template <uint32_t TOTAL_FREQUENCY, typename LAYOUT = NeuralinkLayout>
+class BasicAdaptiveModel : public BasicModel<TOTAL_FREQUENCY, LAYOUT> {
+    using Base = BasicModel<TOTAL_FREQUENCY, LAYOUT>;
+
+public:
+    using typename Base::SymbolType;
+    using typename Base::FrequencyType;
+    using typename Base::Tables;
+    using typename Base::Parameters;
+    static constexpr SymbolType NUM_SYMBOLS = Base::NUM_SYMBOLS;
+    static const uint16_t NUM_DIST = Base::NUM_DIST;
+
+    // symbols of a distribution between rebuilds of its table
+    static constexpr uint32_t REBUILD_INTERVAL = 1024;
+
+    // count added per symbol, the static table contributes MAX_FREQUENCY to the initial counts
+    static constexpr uint32_t INCREMENT = 32;
+
+    // total count of a distribution above which its counts are halved
+    static constexpr uint32_t COUNT_LIMIT = 1u << 22;
+
+    BasicAdaptiveModel() : BasicAdaptiveModel(Parameters(), Base::default_tables()) {}
+
+    /**
+     * @brief An adaptive model with other constants.
+     *
+     * @param parameters The model constants.
+     * @param model_tables The initial tables. They are shared until a distribution is rebuilt,
+     *        and must outlive the model.
+     */
+    BasicAdaptiveModel(const Parameters &parameters, const Tables &model_tables)
+        : Base(parameters, model_tables), base_tables(&model_tables)
+    {
+        totals.fill(Base::MAX_FREQUENCY);
+        updates.fill(0);
+    }
+
+    BasicAdaptiveModel(const BasicAdaptiveModel &other)
+        : Base(other), base_tables(other.base_tables), totals(other.totals), updates(other.updates), logged(other.logged) {
+        copy_rows(other);
+    }
+
+    BasicAdaptiveModel &operator=(const BasicAdaptiveModel &other) {
+        Base::operator=(other);
+        base_tables = other.base_tables;
+        totals = other.totals;
+        updates = other.updates;
+        logged = other.logged;
+        copy_rows(other);
+        return *this;
+    }
+
+    void update_state(SymbolType symbol) {
+        // count the symbol in the distribution and at the shifted position it was coded with
+        const uint16_t dist = this->active_dist;
+        const uint32_t loc = (static_cast<uint32_t>(symbol) + NUM_SYMBOLS + this->active_symbol_shift) % NUM_SYMBOLS;
+        if (rows[dist]) {
+            rows[dist]->counts[loc] += INCREMENT;
+        } else {
+            logged[dist].push_back(static_cast<SymbolType>(loc));
+        }
+        totals[dist] += INCREMENT;
+        if (++updates[dist] == REBUILD_INTERVAL) {
+            rebuild(dist);
+        }
+
+        Base::update_state(symbol);
+    }
+
+    SymbolType frequency_symbol(FrequencyType freq) {
+        const uint16_t dist = this->active_dist;
+        if (rows[dist] && rows[dist]->lookup_stale) {
+            rows[dist]->lookup.resize(Base::LOOKUP_SIZE);
+            Base::compute_lookup(rows[dist]->ccft.data(), rows[dist]->lookup.data());
+            rows[dist]->lookup_stale = false;
+            this->lookup_rows[dist] = rows[dist]->lookup.data();
+        }
+        return Base::frequency_symbol(freq);
+    }
+
+    /**
+     * @brief Saves the dynamic state including the adapted rows, see checkpoint.hpp.
+     */
+    void save(CheckpointWriter &writer) const {
+        Base::save(writer);
+        for (int i = 0; i < NUM_DIST; ++i) {
+            writer.put(totals[i], 4);
+            writer.put(updates[i], 4);
+            writer.put(rows[i] ? 1 : 0, 1);
+            if (rows[i]) {
+                for (FrequencyType f : rows[i]->ccft) {
+                    writer.put(f, sizeof(FrequencyType));
+                }
+                for (uint32_t count : rows[i]->counts) {
+                    writer.put(count, 4);
+                }
+            } else {
+                for (SymbolType loc : logged[i]) {
+                    writer.put(loc, sizeof(SymbolType));
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Restores the dynamic state into a model with the parameters and initial tables
+     *        of the saved model.
+     *
+     * @throws std::runtime_error if the checkpoint is truncated or invalid.
+     */
+    void restore(CheckpointReader &reader) {
+        Base::restore(reader);
+        for (int i = 0; i < NUM_DIST; ++i) {
+            totals[i] = static_cast<uint32_t>(reader.get(4));
+            updates[i] = static_cast<uint32_t>(reader.get(4));
+            if (totals[i] == 0 || totals[i] > COUNT_LIMIT + INCREMENT * REBUILD_INTERVAL ||
+                updates[i] >= REBUILD_INTERVAL) {
+                throw std::runtime_error("Invalid model checkpoint");
+            }
+            logged[i].clear();
+            if (reader.get(1)) {
+                rows[i].reset(new Row);
+                for (FrequencyType &f : rows[i]->ccft) {
+                    f = static_cast<FrequencyType>(reader.get(sizeof(FrequencyType)));
+                }
+                // the coders need every symbol to have a nonzero frequency within the total
+                const std::array<FrequencyType, NUM_SYMBOLS + 1> &ccft = rows[i]->ccft;
+                if (ccft[0] != 0 || ccft[NUM_SYMBOLS] != Base::MAX_FREQUENCY) {
+                    throw std::runtime_error("Invalid model checkpoint");
+                }
+                for (uint32_t j = 0; j < NUM_SYMBOLS; ++j) {
+                    if (ccft[j] >= ccft[j + 1]) {
+                        throw std::runtime_error("Invalid model checkpoint");
+                    }
+                }
+                // the rebuilds divide the counts by their total
+                uint64_t total = 0;
+                for (uint32_t &count : rows[i]->counts) {
+                    count = static_cast<uint32_t>(reader.get(4));
+                    total += count;
+                }
+                if (total != totals[i]) {
+                    throw std::runtime_error("Invalid model checkpoint");
+                }
+            } else {
+                rows[i].reset();
+                if (totals[i] != Base::MAX_FREQUENCY + INCREMENT * updates[i]) {
+                    throw std::runtime_error("Invalid model checkpoint");
+                }
+                for (uint32_t j = 0; j < updates[i]; ++j) {
+                    const SymbolType loc = static_cast<SymbolType>(reader.get(sizeof(SymbolType)));
+                    if (loc >= NUM_SYMBOLS) {
+                        throw std::runtime_error("Invalid model checkpoint");
+                    }
+                    logged[i].push_back(loc);
+                }
+            }
+            attach_row(i);
+        }
+    }
+
+    /**
+     * @brief The number of distributions with a row of their own.
+     */
+    size_t owned_rows() const {
+        size_t n = 0;
+        for (const std::unique_ptr<Row> &row : rows) {
+            n += row ? 1 : 0;
+        }
+        return n;
+    }
+
+    /**
+     * @brief The heap memory of the rows of the model, without the size of the model itself.
+     */
+    size_t row_bytes() const {
+        size_t bytes = 0;
+        for (int i = 0; i < NUM_DIST; ++i) {
+            bytes += logged[i].capacity() * sizeof(SymbolType);
+            if (rows[i]) {
+                bytes += sizeof(Row) + rows[i]->lookup.capacity() * sizeof(SymbolType);
+            }
+        }
+        return bytes;
+    }
+
+private:
+    // the adapted ccft row, counts and reverse lookup of a distribution
+    struct Row {
+        std::array<FrequencyType, NUM_SYMBOLS + 1> ccft;
+        std::array<uint32_t, NUM_SYMBOLS> counts;
+        std::vector<SymbolType> lookup; ///< empty until the first search
+        bool lookup_stale = true;       ///< whether the lookup misses the last rebuild
+    };
+
+    const Tables *base_tables;
+    std::array<std::unique_ptr<Row>, NUM_DIST> rows;
+    std::array<uint32_t, NUM_DIST> totals;
+    std::array<uint32_t, NUM_DIST> updates;
+    std::array<std::vector<SymbolType>, NUM_DIST> logged; ///< positions counted before the first rebuild
+
+    void copy_rows(const BasicAdaptiveModel &other) {
+        for (int i = 0; i < NUM_DIST; ++i) {
+            rows[i].reset(other.rows[i] ? new Row(*other.rows[i]) : nullptr);
+            attach_row(i);
+        }
+    }
+
+    void attach_row(int i) {
+        if (rows[i]) {
+            this->ccft_rows[i] = rows[i]->ccft.data();
+            this->lookup_rows[i] = rows[i]->lookup.data();
+        } else {
+            this->ccft_rows[i] = base_tables->ccft[i].data();
+            this->lookup_rows[i] = base_tables->ccft_lookup[i].data();
+        }
+    }
+
+    /**
+     * @brief Rebuilds the ccft row and reverse lookup of distribution i from its counts.
+     *
+     * Every symbol keeps a frequency of at least one, the remaining MAX_FREQUENCY - NUM_SYMBOLS
+     * is divided in proportion to the counts, like in compute_ccft.
+     */
+    void rebuild(uint16_t i) {
+        updates[i] = 0;
+        if (!rows[i]) {
+            // the first rebuild: the counts are the static frequencies plus the logged symbols
+            rows[i].reset(new Row);
+            const auto &base = base_tables->ccft[i];
+            for (int j = 0; j < NUM_SYMBOLS; ++j) {
+                rows[i]->counts[j] = base[j + 1] - base[j];
+            }
+            for (SymbolType loc : logged[i]) {
+                rows[i]->counts[loc] += INCREMENT;
+            }
+            std::vector<SymbolType>().swap(logged[i]);
+            attach_row(i);
+        }
+
+        auto &counts = rows[i]->counts;
+        if (totals[i] > COUNT_LIMIT) {
+            uint32_t total = 0;
+            for (int j = 0; j < NUM_SYMBOLS; ++j) {
+                counts[j] = (counts[j] + 1) >> 1;
+                total += counts[j];
+            }
+            totals[i] = total;
+        }
+
+        auto &row = rows[i]->ccft;
+        const uint64_t budget = Base::MAX_FREQUENCY - NUM_SYMBOLS;
+        uint64_t cumulative = 0;
+        row[0] = 0;
+        for (int j = 1; j <= NUM_SYMBOLS; ++j) {
+            cumulative += counts[j - 1];
+            row[j] = static_cast<FrequencyType>(j + cumulative * budget / totals[i]);
+        }
+        rows[i]->lookup_stale = true;
+    }
+};
+
+
+/**
+ * @brief Estimates the coded size of a stream of symbols under a model, without running a coder.
+ *
+ * Sums -log2 of the probability (high - low) / MAX_FREQUENCY of every symbol, from a table
+ * over all frequency differences, which is within a few bytes of the arithmetic coded size.
+ * The model is advanced as in the coders, and there is no renormalization and no bit output.
+ *
+ * @tparam M The model type.
+ */
+template <typename M>
+class EntropyEstimator {
+public:
+    using SymbolType = typename M::SymbolType;
+
+    /**
+     * @param model The initial model state, a copy is advanced.
+     */
+    explicit EntropyEstimator(const M &model = M()) : model(model) {}
+
+    /**
+     * @brief Adds the cost of the next `count` symbols of the stream.
+     */
+    void add(const SymbolType *symbols, size_t count) {
+        const double *table = cost().data();
+        typename M::FrequencyType low, high;
+        double sum = 0;
+        for (size_t i = 0; i < count; ++i) {
+            model.symbol_low_high(symbols[i], low, high);
+            sum += table[high - low];
+            model.update_state(symbols[i]);
+        }
+        total_bits += sum;
+        total_symbols += count;
+    }
+
+    /**
+     * @brief The estimated size in bits of the symbols added so far.
+     */
+    double bits() const {
+        return total_bits;
+    }
+
+    size_t symbols() const {
+        return total_symbols;
+    }
+
+private:
+    M model;
+    double total_bits = 0;
+    size_t total_symbols = 0;
+
+    // -log2(f / MAX_FREQUENCY) of every frequency difference f
+    static const std::vector<double> &cost() {
+        static const std::vector<double> table = [] {
+            std::vector<double> c(M::MAX_FREQUENCY + 1, 0.0);
+            for (uint32_t f = 1; f <= M::MAX_FREQUENCY; ++f) {
+                c[f] = std::log2(static_cast<double>(M::MAX_FREQUENCY) / f);
+            }
+            return c;
+        }();
+        return table;
+    }
+};
+
+
+/**
+ * @brief Estimates the coded size of symbols under a model, see EntropyEstimator.
+ *
+ * @param model The initial model state, a copy is advanced.
+ * @return The estimated size in bits.
+ */
+template <typename M>
+double model_entropy_bits(const M &model, const typename M::SymbolType *symbols, size_t count) {
+    EntropyEstimator<M> estimator(model);
+    estimator.add(symbols, count);
+    return estimator.bits();
+}
+
+// The model with the original 2^15 - 1 frequency total
+typedef BasicModel<0x7FFF> Model;
+
+// Model variant with a 2^K frequency total, for which the coders scale with shifts
+template <int K>
+using Pow2Model = BasicModel<(1u << K)>;
+
+// The fixed-point model with the original 2^15 - 1 frequency total
+typedef BasicFixedPointModel<0x7FFF> FixedPointModel;
+
+// The adaptive model with the original 2^15 - 1 frequency total
+typedef BasicAdaptiveModel<0x7FFF> AdaptiveModel;
+
+// The model with the original 2^15 - 1 frequency total and exactly 1024 symbols, without a stop symbol
+typedef BasicModel<0x7FFF, NeuralinkStoplessLayout> StoplessModel;
+
+
 #endif
\ No newline at end of file
@@ -0,0 +1,185 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PACKETS_HPP
+#define PACKETS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include "bitstream.hpp"
+#include "neuralink.hpp"
+
+/*
+ * Packet payload layout
+ *
+ * When the stream header has a non-zero packet size, the coder is flushed after every packet
+ * of that many samples and starts a new code word on a byte boundary, while the model state
+ * carries over. A receiver can decode each packet as soon as it arrives, so the delay of a
+ * sample is bounded by the packet size, not by when the coder happens to release bits:
+ *
+ *   per packet   2 bytes sample count, 2 bytes coded size, the coded packet
+ *   terminator   4 zero bytes
+ *
+ * Packets hold no stop symbol, the last packet may hold fewer samples. Multi-byte values are
+ * little endian.
+ */
+
+// Largest packet size, so that the coded size of a packet always fits in the 2 byte field
+static constexpr size_t MAX_PACKET_SAMPLES = 16384;
+static constexpr size_t PACKET_RECORD_SIZE = 4;
+
+
+/**
+ * @brief Writes a 16 bit little endian value to a byte buffer.
+ */
+inline void packet_put_u16(uint8_t *bytes, uint16_t value) {
+    bytes[0] = static_cast<uint8_t>(value);
+    bytes[1] = static_cast<uint8_t>(value >> 8);
+}
+
+
+/**
+ * @brief Reads a 16 bit little endian value from a byte buffer.
+ */
+inline uint16_t packet_get_u16(const uint8_t *bytes) {
+    return static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+}
+
+
+/**
+ * @brief An upper bound of the coded size of a packet in bytes.
+ *
+ * A renormalized coder range spans at least 2^15 values and a symbol has a frequency of at
+ * least 1, so no symbol costs more than 17 bits. Terminating the code word costs at most 8 bytes.
+ */
+constexpr size_t max_packet_bytes(size_t samples) {
+    return (17 * samples + 7) / 8 + 8;
+}
+
+
+/**
+ * @brief Coder statistics of a single packet.
+ */
+struct PacketInfo {
+    size_t samples;    ///< number of samples in the packet
+    size_t bytes;      ///< coded size of the packet
+    size_t flush_bits; ///< bits written by terminating the code word, including byte padding
+};
+
+
+/**
+ * @brief Codes consecutive packets of samples with one model, flushing the coder after each.
+ *
+ * @tparam Encoder The coder engine, ArithmeticEncoder or RangeEncoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Encoder, typename M>
+class PacketEncoder {
+    using SymbolType = typename M::SymbolType;
+
+public:
+    /**
+     * @param model The initial model state, a default model unless the parameters were fitted.
+     */
+    explicit PacketEncoder(const M &model = M()) : bitstream(max_packet_bytes(MAX_PACKET_SAMPLES)) {
+        coder.model = model;
+    }
+
+    /**
+     * @brief Codes one packet.
+     *
+     * @param symbols The symbols of the packet.
+     * @param count The number of symbols, at most MAX_PACKET_SAMPLES.
+     * @param out Receives the coded packet.
+     * @param capacity The size of `out`, max_packet_bytes(count) is always enough.
+     * @return The sizes and the termination overhead of the packet.
+     * @throws std::runtime_error if the packet is too large or does not fit in `out`.
+     */
+    PacketInfo encode(const SymbolType *symbols, size_t count, uint8_t *out, size_t capacity) {
+        if (count > MAX_PACKET_SAMPLES) {
+            throw std::runtime_error("Packet too large");
+        }
+        bitstream.clear();
+        coder.restart();
+        for (size_t i = 0; i < count; ++i) {
+            coder.encode(symbols[i], bitstream);
+            coder.model.update_state(symbols[i]);
+        }
+        const size_t coded_bits = coder.bits_written;
+        coder.flush(bitstream);
+        bitstream.flush();
+
+        PacketInfo info;
+        info.samples = count;
+        info.bytes = bitstream.size();
+        info.flush_bits = 8 * info.bytes - (coded_bits - packet_start_bits);
+        packet_start_bits = coder.bits_written;
+
+        if (info.bytes > capacity) {
+            throw std::runtime_error("Packet buffer too small");
+        }
+        bitstream.take(out, capacity);
+        return info;
+    }
+
+private:
+    Encoder<M> coder;
+    OBitStream bitstream;
+    size_t packet_start_bits = 0;
+};
+
+
+/**
+ * @brief Decodes consecutive packets coded by PacketEncoder.
+ *
+ * @tparam Decoder The coder engine, ArithmeticDecoder or RangeDecoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Decoder, typename M>
+class PacketDecoder {
+    using SymbolType = typename M::SymbolType;
+
+public:
+    /**
+     * @param model The initial model state, the same as the one of the encoder.
+     */
+    explicit PacketDecoder(const M &model = M()) {
+        coder.model = model;
+    }
+
+    /**
+     * @brief Decodes one packet, which must follow the previously decoded packet.
+     *
+     * @param bytes The coded packet.
+     * @param size The coded size in bytes.
+     * @param count The number of symbols in the packet.
+     * @param symbols Receives the `count` symbols.
+     * @throws std::runtime_error if the packet decodes to a stop symbol.
+     */
+    void decode(const uint8_t *bytes, size_t size, size_t count, SymbolType *symbols) {
+        IBitStream bitstream(bytes, size);
+        coder.restart();
+        coder.init(bitstream);
+        if (coder.decode_n(bitstream, symbols, count) != count) {
+            throw std::runtime_error("Corrupt packet");
+        }
+    }
+
+private:
+    Decoder<M> coder;
+};
+
+#endif
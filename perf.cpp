@@ -0,0 +1,832 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "wav.hpp"
+#include "neuralink.hpp"
+#include "bitstream.hpp"
+#include "arithmetic_coding.hpp"
+#include "stats.hpp"
+#include "threadpool.hpp"
+
+/*
+ * End-to-end throughput and latency regression harness of the encode and decode tools.
+ *
+ * Usage: perftest [options] file.wav ...
+ *
+ * Every recording is encoded and decoded by the command-line tools, as separate processes,
+ * with several recordings in flight at once. The harness checks that the round trip is
+ * lossless and reports, per recording and over the corpus, the compression ratio, the MB/s of
+ * encode and decode, and the peak resident memory of each process. The startup time is that
+ * of the tools on a recording without samples, and it is subtracted from the run times of the
+ * MB/s. Recordings that code in less than MIN_TIMED_SECONDS after that have no MB/s, their
+ * time is mostly noise. The p99 latency of a single sample is measured in-process, on the
+ * first channel, for the per-sample encode and decode steps of the default model and
+ * arithmetic coder. The run with the lowest p99 of `repeat` runs is kept, and channels with
+ * fewer than MIN_LATENCY_SAMPLES samples have no p99.
+ *
+ * The results can be written as a baseline JSON file. Against a baseline every metric is
+ * checked, and a metric that is worse than the tolerance allows fails the run. It runs on
+ * Linux and macOS alike.
+ */
+
+
+using Clock = std::chrono::steady_clock;
+
+// relative loss of compression ratio that counts as a regression, the ratio is deterministic
+static constexpr double RATIO_TOLERANCE = 1e-4;
+
+// number of runs of the tools on an empty recording for the startup time, the fastest is kept
+static constexpr int STARTUP_RUNS = 10;
+
+// shortest run time without the startup for which the MB/s are reported and compared
+static constexpr double MIN_TIMED_SECONDS = 0.05;
+
+// fewest samples for which the p99 latency is reported and compared
+static constexpr uint64_t MIN_LATENCY_SAMPLES = 1 << 14;
+
+// keeps the compiler from dropping the latency loops
+static volatile int16_t sink;
+
+
+struct PerfSettings {
+    size_t jobs = 1;                        ///< recordings coded concurrently
+    int repeat = 3;                         ///< runs per recording, the fastest is reported
+    int threads = 1;                        ///< --threads of the tools
+    std::string encoder = "./encode";       ///< path of the encode tool
+    std::string decoder = "./decode";       ///< path of the decode tool
+    std::vector<std::string> options;       ///< extra encode options, e.g. --coder=range
+    std::string baseline;                   ///< baseline to compare with, empty for none
+    std::string writeBaseline;              ///< file to write the results to, empty for none
+    double tolerance = 0.10;                ///< relative slowdown or growth that fails the run
+};
+
+
+/**
+ * @brief A metric of the report, with the direction in which it improves.
+ *
+ * Small values are dominated by timer resolution and noise, so a metric only regresses when
+ * it is also worse by more than an absolute slack.
+ */
+struct MetricSpec {
+    const char *name;
+    bool higherIsBetter;
+    double slack;
+};
+
+static const MetricSpec METRICS[] = {
+    {"ratio", true, 0.0},
+    {"eval_ratio", true, 0.0},
+    {"encode_mb_s", true, 1.0},
+    {"decode_mb_s", true, 1.0},
+    {"encode_p99_ns", false, 10.0},
+    {"decode_p99_ns", false, 10.0},
+    {"encode_rss_kb", false, 256.0},
+    {"decode_rss_kb", false, 256.0},
+    {"startup_encode_ms", false, 0.2},
+    {"startup_decode_ms", false, 0.2},
+};
+
+
+struct ProcessResult {
+    bool ok = false;
+    double seconds = 0;
+    double rssKb = 0;
+};
+
+
+struct FileResult {
+    std::string path;
+    std::string error;
+    bool lossless = false;
+    uint64_t rawBytes = 0;
+    uint64_t codedBytes = 0;
+    ProcessResult encode;
+    ProcessResult decode;
+    LatencyHistogram encodeLatency;
+    LatencyHistogram decodeLatency;
+};
+
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+
+uint64_t fileSize(const std::string &path) {
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+
+std::vector<char> readFile(const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+}
+
+
+/**
+ * @brief Runs a tool to completion with its output discarded, and measures it.
+ *
+ * The wall time includes the process startup. The peak resident memory comes from the
+ * resource usage of the child, which Linux reports in KiB and macOS in bytes.
+ */
+ProcessResult runProcess(const std::vector<std::string> &args) {
+    std::vector<char *> argv;
+    for (const std::string &arg : args) {
+        argv.push_back(const_cast<char *>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+
+    ProcessResult result;
+    const Clock::time_point start = Clock::now();
+    const pid_t pid = fork();
+    if (pid < 0) {
+        return result;
+    }
+    if (pid == 0) {
+        const int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+            dup2(null, STDERR_FILENO);
+        }
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) != pid) {
+        return result;
+    }
+    result.seconds = secondsSince(start);
+    result.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#if defined(__APPLE__)
+    result.rssKb = static_cast<double>(usage.ru_maxrss) / 1024.0;
+#else
+    result.rssKb = static_cast<double>(usage.ru_maxrss);
+#endif
+    return result;
+}
+
+
+/**
+ * @brief Runs a tool `repeat` times, keeps the fastest run and the largest peak memory.
+ */
+ProcessResult runBest(const std::vector<std::string> &args, int repeat) {
+    ProcessResult best;
+    for (int r = 0; r < repeat; ++r) {
+        const ProcessResult run = runProcess(args);
+        if (!run.ok) {
+            return ProcessResult();
+        }
+        best.seconds = r == 0 ? run.seconds : std::min(best.seconds, run.seconds);
+        best.rssKb = std::max(best.rssKb, run.rssKb);
+        best.ok = true;
+    }
+    return best;
+}
+
+
+std::vector<std::string> encodeArgs(const PerfSettings &settings, const std::string &input, const std::string &output) {
+    std::vector<std::string> args(1, settings.encoder);
+    args.push_back("--threads=" + std::to_string(settings.threads));
+    args.insert(args.end(), settings.options.begin(), settings.options.end());
+    args.push_back(input);
+    args.push_back(output);
+    return args;
+}
+
+
+std::vector<std::string> decodeArgs(const PerfSettings &settings, const std::string &input, const std::string &output) {
+    std::vector<std::string> args(1, settings.decoder);
+    args.push_back("--threads=" + std::to_string(settings.threads));
+    args.push_back(input);
+    args.push_back(output);
+    return args;
+}
+
+
+/**
+ * @brief Samples of the first channel of a recording.
+ */
+std::vector<int16_t> readFirstChannel(const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Error opening input file: " + path);
+    }
+    const size_t channels = neuralink_check_wav_header(read_wav_header(input));
+
+    std::vector<int16_t> samples;
+    std::vector<int16_t> chunk(channels << 12);
+    size_t count;
+    while ((count = neuralink_read_samples_from_stream(input, chunk.data(), chunk.size())) > 0) {
+        for (size_t i = 0; i < count; i += channels) {
+            samples.push_back(chunk[i]);
+        }
+    }
+    return samples;
+}
+
+
+/**
+ * @brief Times the per-sample encode and decode steps, from 16-bit sample to 16-bit sample.
+ */
+void timeSteps(const std::vector<int16_t> &samples, LatencyHistogram &encodeLatency, LatencyHistogram &decodeLatency) {
+    OBitStream output(2 * samples.size() + 64);
+    ArithmeticEncoder<Model> encoder;
+    for (int16_t sample : samples) {
+        const uint64_t t0 = read_ticks();
+        const SymbolType symbol = neuralink_16bit_to_10bit(sample);
+        encoder.encode(symbol, output);
+        encoder.model.update_state(symbol);
+        encodeLatency.add_ticks(read_ticks() - t0);
+    }
+    encoder.encode(Model::STOP_SYMBOL, output);
+    encoder.flush(output);
+    output.flush();
+
+    IBitStream input(output.data(), output.size());
+    ArithmeticDecoder<Model> decoder;
+    decoder.init(input);
+    for (size_t i = 0; i < samples.size(); ++i) {
+        const uint64_t t0 = read_ticks();
+        const SymbolType symbol = decoder.decode(input);
+        decoder.model.update_state(symbol);
+        sink = neuralink_10bit_to_16bit(symbol);
+        decodeLatency.add_ticks(read_ticks() - t0);
+    }
+}
+
+
+/**
+ * @brief Times the steps `repeat` times and keeps the histograms with the lowest p99.
+ */
+void measureLatency(const std::string &path, int repeat, FileResult &result) {
+    const std::vector<int16_t> samples = readFirstChannel(path);
+    for (int r = 0; r < repeat; ++r) {
+        LatencyHistogram encodeLatency, decodeLatency;
+        timeSteps(samples, encodeLatency, decodeLatency);
+        if (r == 0 || encodeLatency.percentile(0.99) < result.encodeLatency.percentile(0.99)) {
+            result.encodeLatency = encodeLatency;
+        }
+        if (r == 0 || decodeLatency.percentile(0.99) < result.decodeLatency.percentile(0.99)) {
+            result.decodeLatency = decodeLatency;
+        }
+    }
+}
+
+
+/**
+ * @brief Encodes and decodes one recording with the tools, and checks the round trip.
+ */
+void runFile(const PerfSettings &settings, const std::string &workDir, size_t index, FileResult &result) {
+    const std::string coded = workDir + "/" + std::to_string(index) + ".brainwire";
+    const std::string copy = workDir + "/" + std::to_string(index) + ".wav";
+    result.rawBytes = fileSize(result.path);
+
+    result.encode = runBest(encodeArgs(settings, result.path, coded), settings.repeat);
+    if (!result.encode.ok) {
+        result.error = "encode failed";
+    } else {
+        result.codedBytes = fileSize(coded);
+        result.decode = runBest(decodeArgs(settings, coded, copy), settings.repeat);
+        if (!result.decode.ok) {
+            result.error = "decode failed";
+        } else {
+            result.lossless = readFile(result.path) == readFile(copy);
+            if (!result.lossless) {
+                result.error = "round trip is not lossless";
+            }
+        }
+    }
+    std::remove(coded.c_str());
+    std::remove(copy.c_str());
+
+    if (result.error.empty()) {
+        try {
+            measureLatency(result.path, settings.repeat, result);
+        } catch (const std::exception &e) {
+            result.error = e.what();
+        }
+    }
+}
+
+
+/**
+ * @brief Startup time of the tools, on a copy of the header of a recording without its samples.
+ */
+std::pair<double, double> measureStartup(const PerfSettings &settings, const std::string &workDir, const std::string &path) {
+    std::ifstream input(path, std::ios::binary);
+    std::vector<uint8_t> header = read_wav_header(input);
+    if (!input) {
+        return std::make_pair(0.0, 0.0);
+    }
+    set_wav_data_size(header, 0);
+
+    const std::string empty = workDir + "/empty.wav";
+    const std::string coded = workDir + "/empty.brainwire";
+    const std::string copy = workDir + "/empty.copy.wav";
+    {
+        std::ofstream output(empty, std::ios::binary);
+        write_wav_header(output, header);
+    }
+    const ProcessResult encode = runBest(encodeArgs(settings, empty, coded), STARTUP_RUNS);
+    const ProcessResult decode = runBest(decodeArgs(settings, coded, copy), STARTUP_RUNS);
+    std::remove(empty.c_str());
+    std::remove(coded.c_str());
+    std::remove(copy.c_str());
+    return std::make_pair(encode.ok ? encode.seconds * 1e3 : 0.0, decode.ok ? decode.seconds * 1e3 : 0.0);
+}
+
+
+using Metrics = std::map<std::string, double>;
+
+/**
+ * @brief Sets a MB/s metric if the coding time, without the startup, is long enough to measure.
+ */
+void setThroughput(Metrics &m, const char *name, uint64_t bytes, double seconds) {
+    if (seconds >= MIN_TIMED_SECONDS) {
+        m[name] = bytes / seconds / 1e6;
+    }
+}
+
+
+/**
+ * @brief Sets a p99 latency metric if enough samples were timed.
+ */
+void setLatency(Metrics &m, const char *name, const LatencyHistogram &latency) {
+    if (latency.total >= MIN_LATENCY_SAMPLES) {
+        m[name] = latency.percentile(0.99);
+    }
+}
+
+
+/**
+ * @brief Run time of a tool without its startup time in ms.
+ */
+double codingSeconds(const ProcessResult &r, double startupMs) {
+    return std::max(0.0, r.seconds - startupMs / 1e3);
+}
+
+
+Metrics fileMetrics(const FileResult &r, std::pair<double, double> startup) {
+    Metrics m;
+    m["ratio"] = r.codedBytes ? static_cast<double>(r.rawBytes) / r.codedBytes : 0.0;
+    setThroughput(m, "encode_mb_s", r.rawBytes, codingSeconds(r.encode, startup.first));
+    setThroughput(m, "decode_mb_s", r.rawBytes, codingSeconds(r.decode, startup.second));
+    setLatency(m, "encode_p99_ns", r.encodeLatency);
+    setLatency(m, "decode_p99_ns", r.decodeLatency);
+    m["encode_rss_kb"] = r.encode.rssKb;
+    m["decode_rss_kb"] = r.decode.rssKb;
+    return m;
+}
+
+
+/**
+ * @brief Metrics over the corpus: the throughput over the summed run times, the largest peak
+ * memory, the latency percentiles of all samples, and the ratio of eval.sh, which counts the
+ * size of the tools as compressed data.
+ */
+Metrics aggregateMetrics(const PerfSettings &settings, const std::vector<FileResult> &results, std::pair<double, double> startup) {
+    uint64_t raw = 0, coded = 0;
+    double encodeSeconds = 0, decodeSeconds = 0, encodeRss = 0, decodeRss = 0;
+    LatencyHistogram encodeLatency, decodeLatency;
+    for (const FileResult &r : results) {
+        raw += r.rawBytes;
+        coded += r.codedBytes;
+        encodeSeconds += codingSeconds(r.encode, startup.first);
+        decodeSeconds += codingSeconds(r.decode, startup.second);
+        encodeRss = std::max(encodeRss, r.encode.rssKb);
+        decodeRss = std::max(decodeRss, r.decode.rssKb);
+        encodeLatency.merge(r.encodeLatency);
+        decodeLatency.merge(r.decodeLatency);
+    }
+    const uint64_t tools = fileSize(settings.encoder) + fileSize(settings.decoder);
+
+    Metrics m;
+    m["ratio"] = coded ? static_cast<double>(raw) / coded : 0.0;
+    m["eval_ratio"] = coded ? static_cast<double>(raw) / (coded + tools) : 0.0;
+    setThroughput(m, "encode_mb_s", raw, encodeSeconds);
+    setThroughput(m, "decode_mb_s", raw, decodeSeconds);
+    setLatency(m, "encode_p99_ns", encodeLatency);
+    setLatency(m, "decode_p99_ns", decodeLatency);
+    m["encode_rss_kb"] = encodeRss;
+    m["decode_rss_kb"] = decodeRss;
+    m["startup_encode_ms"] = startup.first;
+    m["startup_decode_ms"] = startup.second;
+    return m;
+}
+
+
+/**
+ * @brief Results keyed by section, "aggregate" or the path of a recording, and metric name.
+ */
+using Report = std::map<std::string, Metrics>;
+
+static const char *AGGREGATE = "aggregate";
+
+
+std::string jsonString(const std::string &s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + "\"";
+}
+
+
+void writeMetrics(std::ostream &out, const Metrics &metrics) {
+    out << "{";
+    bool first = true;
+    for (const auto &metric : metrics) {
+        out << (first ? "" : ", ") << jsonString(metric.first) << ": " << metric.second;
+        first = false;
+    }
+    out << "}";
+}
+
+
+/**
+ * @brief Writes a report as JSON: {"settings": {...}, "aggregate": {...}, "files": {path: {...}}}.
+ */
+void writeReport(const std::string &path, const PerfSettings &settings, const Report &report) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Error opening baseline file: " + path);
+    }
+    std::string options;
+    for (const std::string &option : settings.options) {
+        options += (options.empty() ? "" : " ") + option;
+    }
+    out << std::setprecision(8);
+    out << "{" << std::endl;
+    out << "  \"settings\": {\"jobs\": " << settings.jobs << ", \"repeat\": " << settings.repeat
+        << ", \"threads\": " << settings.threads << ", \"options\": " << jsonString(options) << "}," << std::endl;
+    out << "  \"aggregate\": ";
+    writeMetrics(out, report.at(AGGREGATE));
+    out << "," << std::endl << "  \"files\": {";
+    bool first = true;
+    for (const auto &section : report) {
+        if (section.first == AGGREGATE) {
+            continue;
+        }
+        out << (first ? "" : ",") << std::endl << "    " << jsonString(section.first) << ": ";
+        writeMetrics(out, section.second);
+        first = false;
+    }
+    out << std::endl << "  }" << std::endl << "}" << std::endl;
+}
+
+
+/**
+ * @brief Reader for the JSON written by writeReport, or any JSON with the same layout.
+ *
+ * Parses objects, arrays, strings, numbers and literals, and keeps the numbers of the
+ * "aggregate" object and of the objects in "files".
+ */
+class BaselineReader {
+public:
+    explicit BaselineReader(const std::string &text) : text(text), pos(0) {}
+
+    Report read() {
+        Report report;
+        std::vector<std::string> path;
+        value(path, report);
+        skipSpace();
+        if (pos != text.size()) {
+            fail();
+        }
+        return report;
+    }
+
+private:
+    const std::string &text;
+    size_t pos;
+
+    void fail() const {
+        throw std::runtime_error("Invalid baseline JSON at offset " + std::to_string(pos));
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) {
+            pos++;
+        }
+    }
+
+    bool consume(char c) {
+        skipSpace();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    std::string string() {
+        if (!consume('"')) {
+            fail();
+        }
+        std::string s;
+        while (pos < text.size() && text[pos] != '"') {
+            if (text[pos] == '\\' && ++pos == text.size()) {
+                fail();
+            }
+            s += text[pos++];
+        }
+        if (pos++ == text.size()) {
+            fail();
+        }
+        return s;
+    }
+
+    void value(std::vector<std::string> &path, Report &report) {
+        skipSpace();
+        if (pos == text.size()) {
+            fail();
+        }
+        const char c = text[pos];
+        if (c == '{') {
+            pos++;
+            if (consume('}')) {
+                return;
+            }
+            do {
+                path.push_back(string());
+                if (!consume(':')) {
+                    fail();
+                }
+                value(path, report);
+                path.pop_back();
+            } while (consume(','));
+            if (!consume('}')) {
+                fail();
+            }
+        } else if (c == '[') {
+            pos++;
+            if (consume(']')) {
+                return;
+            }
+            do {
+                std::vector<std::string> ignored;
+                Report unused;
+                value(ignored, unused);
+            } while (consume(','));
+            if (!consume(']')) {
+                fail();
+            }
+        } else if (c == '"') {
+            string();
+        } else if (std::isalpha(static_cast<unsigned char>(c))) {
+            while (pos < text.size() && std::isalpha(static_cast<unsigned char>(text[pos]))) {
+                pos++;
+            }
+        } else {
+            char *end = nullptr;
+            const double number = std::strtod(text.c_str() + pos, &end);
+            if (end == text.c_str() + pos) {
+                fail();
+            }
+            pos = end - text.c_str();
+            if (path.size() == 2 && path[0] == AGGREGATE) {
+                report[AGGREGATE][path[1]] = number;
+            } else if (path.size() == 3 && path[0] == "files" && path[1] != AGGREGATE) {
+                report[path[1]][path[2]] = number;
+            }
+        }
+    }
+};
+
+
+Report readBaseline(const std::string &path) {
+    std::ifstream input(path);
+    if (!input) {
+        throw std::runtime_error("Error opening baseline file: " + path);
+    }
+    std::stringstream text;
+    text << input.rdbuf();
+    const std::string s = text.str();
+    return BaselineReader(s).read();
+}
+
+
+/**
+ * @brief Compares the results with a baseline, prints every regression and returns their number.
+ *
+ * Sections and metrics that are missing from either side are not compared, and the aggregate
+ * only when the baseline was measured on the same recordings.
+ */
+size_t compareReports(const Report &baseline, const Report &report, double tolerance) {
+    bool sameFiles = baseline.size() == report.size();
+    for (const auto &section : report) {
+        sameFiles = sameFiles && baseline.count(section.first) != 0;
+    }
+    if (!sameFiles) {
+        std::cout << "the recordings differ from the baseline, the aggregate is not compared" << std::endl;
+    }
+
+    size_t regressions = 0;
+    for (const auto &section : report) {
+        const Report::const_iterator base = baseline.find(section.first);
+        if (base == baseline.end() || (section.first == AGGREGATE && !sameFiles)) {
+            continue;
+        }
+        for (const MetricSpec &spec : METRICS) {
+            const Metrics::const_iterator current = section.second.find(spec.name);
+            const Metrics::const_iterator reference = base->second.find(spec.name);
+            if (current == section.second.end() || reference == base->second.end()) {
+                continue;
+            }
+            const double tol = std::strstr(spec.name, "ratio") ? RATIO_TOLERANCE : tolerance;
+            const double limit = spec.higherIsBetter ? reference->second * (1 - tol) - spec.slack
+                                                     : reference->second * (1 + tol) + spec.slack;
+            const bool regressed = spec.higherIsBetter ? current->second < limit : current->second > limit;
+            if (regressed) {
+                std::cout << "REGRESSION " << section.first << " " << spec.name << ": " << current->second
+                          << " against baseline " << reference->second << std::endl;
+                regressions++;
+            }
+        }
+    }
+    return regressions;
+}
+
+
+// a column of a metric that is only set for long enough runs, "-" if it is missing
+std::string optionalColumn(const Metrics &m, const char *name, int precision) {
+    const Metrics::const_iterator value = m.find(name);
+    if (value == m.end()) {
+        return "-";
+    }
+    std::ostringstream column;
+    column << std::fixed << std::setprecision(precision) << value->second;
+    return column.str();
+}
+
+
+void printRow(const std::string &name, const Metrics &m, const std::string &status) {
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(8) << m.at("ratio")
+              << std::setw(10) << optionalColumn(m, "encode_mb_s", 1)
+              << std::setw(10) << optionalColumn(m, "decode_mb_s", 1)
+              << std::setw(10) << optionalColumn(m, "encode_p99_ns", 0)
+              << std::setw(10) << optionalColumn(m, "decode_p99_ns", 0)
+              << std::setprecision(1)
+              << std::setw(10) << m.at("encode_rss_kb") / 1024.0
+              << std::setw(10) << m.at("decode_rss_kb") / 1024.0
+              << "  " << status << std::endl;
+}
+
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] file.wav ..." << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --jobs=N              recordings coded concurrently (default: number of hardware threads)" << std::endl;
+    std::cerr << "  --repeat=N            runs per recording, the fastest is reported (default: 3)" << std::endl;
+    std::cerr << "  --threads=N           --threads of encode and decode (default: 1)" << std::endl;
+    std::cerr << "  --encoder=PATH        encode tool (default: ./encode)" << std::endl;
+    std::cerr << "  --decoder=PATH        decode tool (default: ./decode)" << std::endl;
+    std::cerr << "  --options=\"...\"       extra encode options, e.g. --options=--coder=range" << std::endl;
+    std::cerr << "  --baseline=FILE       compare with a baseline, regressions fail the run" << std::endl;
+    std::cerr << "  --write-baseline=FILE write the results as a baseline" << std::endl;
+    std::cerr << "  --tolerance=PCT       slowdown or memory growth that is a regression (default: 10)" << std::endl;
+}
+
+
+int main(int argc, char* argv[]) {
+
+    PerfSettings settings;
+    settings.jobs = default_thread_count();
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.compare(0, 7, "--jobs=") == 0) {
+            settings.jobs = std::max(1, std::atoi(arg.c_str() + 7));
+        } else if (arg.compare(0, 9, "--repeat=") == 0) {
+            settings.repeat = std::max(1, std::atoi(arg.c_str() + 9));
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            settings.threads = std::max(1, std::atoi(arg.c_str() + 10));
+        } else if (arg.compare(0, 10, "--encoder=") == 0) {
+            settings.encoder = arg.substr(10);
+        } else if (arg.compare(0, 10, "--decoder=") == 0) {
+            settings.decoder = arg.substr(10);
+        } else if (arg.compare(0, 10, "--options=") == 0) {
+            std::istringstream options(arg.substr(10));
+            std::string option;
+            while (options >> option) {
+                settings.options.push_back(option);
+            }
+        } else if (arg.compare(0, 11, "--baseline=") == 0) {
+            settings.baseline = arg.substr(11);
+        } else if (arg.compare(0, 17, "--write-baseline=") == 0) {
+            settings.writeBaseline = arg.substr(17);
+        } else if (arg.compare(0, 12, "--tolerance=") == 0) {
+            settings.tolerance = std::max(0.0, std::atof(arg.c_str() + 12)) / 100.0;
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.empty()) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try {
+        Report baseline;
+        if (!settings.baseline.empty()) {
+            baseline = readBaseline(settings.baseline);
+        }
+
+        const char *tmp = std::getenv("TMPDIR");
+        std::string workTemplate = std::string(tmp && *tmp ? tmp : "/tmp") + "/neuromasterblaster-perf-XXXXXX";
+        std::vector<char> workBuffer(workTemplate.begin(), workTemplate.end());
+        workBuffer.push_back('\0');
+        if (mkdtemp(workBuffer.data()) == nullptr) {
+            throw std::runtime_error("Error creating a work directory in " + workTemplate);
+        }
+        const std::string workDir(workBuffer.data());
+
+        // the startup time first, while the machine is otherwise idle
+        const std::pair<double, double> startup = measureStartup(settings, workDir, paths[0]);
+
+        std::vector<FileResult> results(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            results[i].path = paths[i];
+        }
+        const Clock::time_point start = Clock::now();
+        ThreadPool pool(std::min(settings.jobs, paths.size()));
+        pool.parallel_for(paths.size(), [&](size_t i) { runFile(settings, workDir, i, results[i]); });
+        const double wall = secondsSince(start);
+        rmdir(workDir.c_str());
+
+        std::cout << "file                           ratio  enc MB/s  dec MB/s   enc p99   dec p99   enc RSS   dec RSS" << std::endl;
+        std::cout << "                                                              (ns)      (ns)      (MB)      (MB)" << std::endl;
+        Report report;
+        size_t failures = 0;
+        for (const FileResult &r : results) {
+            report[r.path] = fileMetrics(r, startup);
+            printRow(r.path, report[r.path], r.error.empty() ? "ok" : "FAILED: " + r.error);
+            failures += r.error.empty() ? 0 : 1;
+        }
+        report[AGGREGATE] = aggregateMetrics(settings, results, startup);
+        printRow("all files", report[AGGREGATE], failures ? "FAILED" : "ok");
+        std::cout << std::setprecision(2) << "startup: encode " << report[AGGREGATE]["startup_encode_ms"]
+                  << " ms, decode " << report[AGGREGATE]["startup_decode_ms"] << " ms" << std::endl;
+        std::cout << std::setprecision(3) << "compression ratio including the executables: "
+                  << report[AGGREGATE]["eval_ratio"] << std::endl;
+        std::cout << std::setprecision(2) << paths.size() << " files in " << wall << " s with "
+                  << pool.size() << " jobs" << std::endl;
+
+        if (!settings.writeBaseline.empty()) {
+            writeReport(settings.writeBaseline, settings, report);
+            std::cout << "baseline written to " << settings.writeBaseline << std::endl;
+        }
+        size_t regressions = 0;
+        if (!settings.baseline.empty()) {
+            std::cout << std::defaultfloat << std::setprecision(6);
+            regressions = compareReports(baseline, report, settings.tolerance);
+            std::cout << regressions << " regressions against " << settings.baseline << std::endl;
+        }
+        return failures == 0 && regressions == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,410 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <thread>
+#include <vector>
+
+/*
+ * Pipelined input and output
+ *
+ * The command-line tools read, code and write on one thread, so a stall of a slow input or
+ * output device, such as a network mount or a pipe, stalls the coder. PipelinedInputStream
+ * and PipelinedOutputStream move the device I/O to a reader and a writer thread. The threads
+ * exchange fixed-size blocks with the coding thread through two single-producer
+ * single-consumer queues per direction: one of filled blocks and one of free blocks. A full
+ * set of filled blocks is the backpressure, the reader waits for a free block and the coder
+ * waits for the writer. The coding loops are unchanged, they see ordinary streams. A block is
+ * allocated, uninitialized, when it is first filled, so a short stream only costs the blocks
+ * it uses.
+ */
+
+
+// size of the blocks exchanged with the reader and the writer thread
+static const size_t PIPELINE_BLOCK_SIZE = 1 << 20;
+
+// number of blocks in flight per direction
+static const size_t PIPELINE_BLOCKS = 4;
+
+
+/**
+ * @brief A bounded lock-free single-producer single-consumer queue.
+ *
+ * push and pop are lock-free while the queue is neither full nor empty. Otherwise the calling
+ * thread sleeps until the other side makes progress or the queue is closed.
+ *
+ * @tparam T The element type, copied in and out.
+ */
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots(capacity + 1) {}
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    /**
+     * @brief Appends a value, waiting while the queue is full.
+     *
+     * @return false if the queue was closed, the value is then dropped.
+     */
+    bool push(const T &value) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t next = (t + 1) % slots.size();
+        if (next == head.load(std::memory_order_acquire)) {
+            wait([this, next] { return next != head.load() || closed.load(); });
+        }
+        if (closed.load()) {
+            return false;
+        }
+        slots[t] = value;
+        tail.store(next);
+        wake();
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest value, waiting while the queue is empty.
+     *
+     * @return false if the queue is empty and closed.
+     */
+    bool pop(T &value) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) {
+            wait([this, h] { return h != tail.load() || closed.load(); });
+            if (h == tail.load()) {
+                return false;
+            }
+        }
+        value = slots[h];
+        head.store((h + 1) % slots.size());
+        wake();
+        return true;
+    }
+
+    /**
+     * @brief Ends the queue, the consumer still pops the values pushed before.
+     */
+    void close() {
+        closed.store(true);
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+    }
+
+private:
+    std::vector<T> slots;
+    std::atomic<size_t> head{0};
+    std::atomic<size_t> tail{0};
+    std::atomic<bool> closed{false};
+
+    // the slow path, only taken by a side that waits for the other one
+    std::atomic<int> sleepers{0};
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    template <typename Predicate>
+    void wait(Predicate ready) {
+        std::unique_lock<std::mutex> lock(mutex);
+        sleepers.fetch_add(1);
+        cv.wait(lock, ready);
+        sleepers.fetch_sub(1);
+    }
+
+    // the sequentially consistent sleepers load after the index store either sees a waiter
+    // or the waiter sees the new index in its predicate
+    void wake() {
+        if (sleepers.load() > 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_all();
+        }
+    }
+};
+
+
+/**
+ * @brief The blocks of one pipeline direction, and the queues that pass them between threads.
+ *
+ * A block is allocated by data() on its first use. Only the thread that popped a block from a
+ * queue touches it, so the allocation needs no lock.
+ */
+class PipelineBlocks {
+public:
+    PipelineBlocks(size_t block_size, size_t blocks)
+        : storage(blocks), sizes(blocks, 0), block_size(block_size),
+          free_blocks(blocks), filled_blocks(blocks) {
+        for (size_t i = 0; i < blocks; ++i) {
+            free_blocks.push(i);
+        }
+    }
+
+    char *data(size_t block) {
+        if (!storage[block]) {
+            storage[block].reset(new char[block_size]);
+        }
+        return storage[block].get();
+    }
+
+    size_t capacity() const {
+        return block_size;
+    }
+
+    std::vector<std::unique_ptr<char[]>> storage;
+    std::vector<size_t> sizes;
+    const size_t block_size;
+    SpscQueue<size_t> free_blocks;
+    SpscQueue<size_t> filled_blocks;
+};
+
+
+/**
+ * @brief A stream buffer that reads a source stream ahead on a background thread.
+ *
+ * Not seekable. An error of the reader thread is rethrown by the next read after the blocks
+ * read before it.
+ */
+class PipelinedInputStreamBuf : public std::streambuf {
+public:
+    explicit PipelinedInputStreamBuf(std::istream &source, size_t block_size = PIPELINE_BLOCK_SIZE, size_t blocks = PIPELINE_BLOCKS)
+        : source(source), blocks(block_size, blocks), reader(&PipelinedInputStreamBuf::read_loop, this) {}
+
+    ~PipelinedInputStreamBuf() {
+        blocks.free_blocks.close();
+        blocks.filled_blocks.close();
+        reader.join();
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) {
+            return traits_type::to_int_type(*gptr());
+        }
+        if (current != NO_BLOCK) {
+            blocks.free_blocks.push(current);
+            current = NO_BLOCK;
+            setg(nullptr, nullptr, nullptr);
+        }
+        size_t block;
+        while (blocks.filled_blocks.pop(block)) {
+            if (blocks.sizes[block] > 0) {
+                current = block;
+                char *begin = blocks.data(block);
+                setg(begin, begin, begin + blocks.sizes[block]);
+                return traits_type::to_int_type(*gptr());
+            }
+            blocks.free_blocks.push(block);
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        return traits_type::eof();
+    }
+
+private:
+    static const size_t NO_BLOCK = static_cast<size_t>(-1);
+
+    std::istream &source;
+    PipelineBlocks blocks;
+    size_t current = NO_BLOCK;
+    std::exception_ptr error;  // written by the reader before it closes the filled queue
+    std::thread reader;
+
+    void read_loop() {
+        try {
+            size_t block;
+            while (blocks.free_blocks.pop(block)) {
+                source.read(blocks.data(block), blocks.capacity());
+                blocks.sizes[block] = static_cast<size_t>(source.gcount());
+                if (source.bad()) {
+                    throw std::runtime_error("Error reading input stream");
+                }
+                const bool end = blocks.sizes[block] < blocks.capacity();
+                if (!blocks.filled_blocks.push(block) || end) {
+                    break;
+                }
+            }
+        } catch (...) {
+            error = std::current_exception();
+        }
+        blocks.filled_blocks.close();
+    }
+};
+
+
+/**
+ * @brief A stream buffer that writes to a sink stream on a background thread.
+ *
+ * Call finish() to write the last block and to rethrow an error of the writer thread.
+ */
+class PipelinedOutputStreamBuf : public std::streambuf {
+public:
+    explicit PipelinedOutputStreamBuf(std::ostream &sink, size_t block_size = PIPELINE_BLOCK_SIZE, size_t blocks = PIPELINE_BLOCKS)
+        : sink(sink), blocks(block_size, blocks), writer(&PipelinedOutputStreamBuf::write_loop, this) {}
+
+    ~PipelinedOutputStreamBuf() {
+        blocks.filled_blocks.close();
+        blocks.free_blocks.close();
+        if (writer.joinable()) {
+            writer.join();
+        }
+    }
+
+    /**
+     * @brief Hands the buffered bytes to the writer, waits for it and flushes the sink.
+     *
+     * @throws std::runtime_error or the error of the writer thread if the output failed.
+     */
+    void finish() {
+        if (writer.joinable()) {
+            hand_over();
+            blocks.filled_blocks.close();
+            writer.join();
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+        if (!sink.flush()) {
+            throw std::runtime_error("Error writing output stream");
+        }
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        send();
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+        return traits_type::not_eof(c);
+    }
+
+    int sync() override {
+        hand_over();
+        return 0;
+    }
+
+private:
+    static const size_t NO_BLOCK = static_cast<size_t>(-1);
+
+    std::ostream &sink;
+    PipelineBlocks blocks;
+    size_t current = NO_BLOCK;
+    std::atomic<bool> failed{false};
+    std::exception_ptr error;  // written by the writer before it returns, read after the join
+    std::thread writer;
+
+    // passes the current block, if it holds any bytes, to the writer
+    void hand_over() {
+        if (current != NO_BLOCK && pptr() > pbase()) {
+            blocks.sizes[current] = static_cast<size_t>(pptr() - pbase());
+            blocks.filled_blocks.push(current);
+            current = NO_BLOCK;
+            setp(nullptr, nullptr);
+        }
+    }
+
+    // passes the current block to the writer and starts the next one
+    void send() {
+        if (failed.load()) {
+            throw std::runtime_error("Error writing output stream");
+        }
+        hand_over();
+        if (current != NO_BLOCK) {
+            setp(pbase(), epptr());
+            return;
+        }
+        if (!writer.joinable() || !blocks.free_blocks.pop(current)) {
+            current = NO_BLOCK;
+            throw std::runtime_error("Error writing output stream");
+        }
+        char *begin = blocks.data(current);
+        setp(begin, begin + blocks.capacity());
+    }
+
+    void write_loop() {
+        size_t block;
+        while (blocks.filled_blocks.pop(block)) {
+            if (!failed.load()) {
+                try {
+                    if (!sink.write(blocks.data(block), blocks.sizes[block])) {
+                        throw std::runtime_error("Error writing output stream");
+                    }
+                } catch (...) {
+                    error = std::current_exception();
+                    failed.store(true);
+                }
+            }
+            blocks.free_blocks.push(block);
+        }
+    }
+};
+
+
+/**
+ * @brief An input stream that reads a source stream ahead on a background thread.
+ *
+ * Errors of the source stream are rethrown by the reads of this stream.
+ */
+class PipelinedInputStream : public std::istream {
+public:
+    explicit PipelinedInputStream(std::istream &source)
+        : std::istream(nullptr), buffer(source) {
+        rdbuf(&buffer);
+        exceptions(std::ios_base::badbit);
+    }
+
+private:
+    PipelinedInputStreamBuf buffer;
+};
+
+
+/**
+ * @brief An output stream that writes to a sink stream on a background thread.
+ *
+ * Write errors of the sink are rethrown by a later write or by finish().
+ */
+class PipelinedOutputStream : public std::ostream {
+public:
+    explicit PipelinedOutputStream(std::ostream &sink)
+        : std::ostream(nullptr), buffer(sink) {
+        rdbuf(&buffer);
+        exceptions(std::ios_base::badbit);
+    }
+
+    /**
+     * @brief Writes all buffered bytes to the sink and flushes it.
+     *
+     * @throws std::runtime_error if the output failed.
+     */
+    void finish() {
+        buffer.finish();
+    }
+
+private:
+    PipelinedOutputStreamBuf buffer;
+};
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef RANGE_CODING_HPP
+#define RANGE_CODING_HPP
+
+#include <cstdint>
+#include <cstdlib>
+#include "bitstream.hpp"
+#include "checkpoint.hpp"
+
+
+// Byte-wise range coder with a 32 bit range and carry propagation on a 64 bit low. The
+// range is renormalized a whole byte at a time as soon as it drops below RANGE_TOP.
+static constexpr uint32_t RANGE_TOP = 1u << 24;
+
+
+/**
+ * @brief Template class for byte-oriented Range Encoding.
+ *
+ * Drop-in alternative for ArithmeticEncoder that uses the same model interface, but
+ * renormalizes whole bytes instead of single bits.
+ *
+ * @tparam T The model type providing frequency and symbol information.
+ */
+template <typename T>
+class RangeEncoder {
+    using SymbolType = typename T::SymbolType;
+    using FrequencyType = typename T::FrequencyType;
+
+public:
+    T model;
+    size_t bits_written;    ///< Number of bits written.
+    size_t symbols_written; ///< Number of symbols written.
+
+    /**
+     * @brief Default constructor.
+     */
+    RangeEncoder() : bits_written(0), symbols_written(0), low(0), range(0xFFFFFFFF), cache(0), cache_size(1) {}
+
+
+    /**
+     * @brief Encodes a symbol and writes bytes to the output stream.
+     *
+     * @param symbol The symbol to encode.
+     * @param bit_stream The output bit stream to write to.
+     */
+    void encode(const SymbolType symbol, OBitStream &bit_stream) {
+        symbols_written++;
+
+        // get the [low, high) cumulative frequency range of a symbol
+        model.symbol_low_high(symbol, symbol_low, symbol_high);
+
+        // rescale low and range
+        uint32_t r = range / T::MAX_FREQUENCY;
+        low += static_cast<uint64_t>(r) * symbol_low;
+        range = r * (symbol_high - symbol_low);
+
+        // write bytes to output
+        while (range < RANGE_TOP) {
+            range <<= 8;
+            shift_low(bit_stream);
+        }
+    }
+
+
+    /**
+     * @brief Flushes the remaining bytes to the output stream.
+     *
+     * @param bit_stream The output bit stream to write to.
+     */
+    void flush(OBitStream &bit_stream) {
+        for (int i=0; i<5; ++i) {
+            shift_low(bit_stream);
+        }
+    }
+
+    /**
+     * @brief Starts a new code word after flush(), keeping the model state.
+     */
+    void restart() {
+        low = 0;
+        range = 0xFFFFFFFF;
+        cache = 0;
+        cache_size = 1;
+    }
+
+    /**
+     * @brief The number of bits in 0xFF bytes waiting for a possible carry.
+     */
+    size_t pending() const {
+        return 8 * static_cast<size_t>(cache_size - 1);
+    }
+
+    /**
+     * @brief Saves the coder and model state, see checkpoint.hpp.
+     */
+    void save(CheckpointWriter &writer) const {
+        writer.put(bits_written, 8);
+        writer.put(symbols_written, 8);
+        writer.put(low, 8);
+        writer.put(range, 4);
+        writer.put(cache, 1);
+        writer.put(cache_size, 8);
+        model.save(writer);
+    }
+
+    /**
+     * @brief Restores the coder and model state, continue with the bit stream state saved with it.
+     */
+    void restore(CheckpointReader &reader) {
+        bits_written = reader.get(8);
+        symbols_written = reader.get(8);
+        low = reader.get(8);
+        range = static_cast<uint32_t>(reader.get(4));
+        cache = static_cast<uint8_t>(reader.get(1));
+        cache_size = reader.get(8);
+        // a symbol shifts out at most 4 bytes, and low keeps 32 bits and a carry
+        if (cache_size == 0 || cache_size - 1 > 4 * symbols_written || range < RANGE_TOP || (low >> 33) != 0) {
+            throw std::runtime_error("Invalid coder checkpoint");
+        }
+        model.restore(reader);
+    }
+
+private:
+    FrequencyType symbol_low, symbol_high;
+    uint64_t low;
+    uint32_t range;
+    uint8_t cache;      // last byte that can still receive a carry
+    uint64_t cache_size; // cache plus the number of pending 0xFF bytes behind it
+
+    /**
+     * @brief Moves the top byte of low to the output, propagating a carry into pending bytes.
+     *
+     * @param bit_stream The output bit stream to write to.
+     */
+    void shift_low(OBitStream &bit_stream) {
+        if (static_cast<uint32_t>(low) < 0xFF000000u || (low >> 32) != 0) {
+            uint8_t carry = static_cast<uint8_t>(low >> 32);
+            uint8_t temp = cache;
+            do {
+                bit_stream.put_bits(static_cast<uint8_t>(temp + carry), 8);
+                bits_written += 8;
+                temp = 0xFF;
+            } while (--cache_size != 0);
+            cache = static_cast<uint8_t>(low >> 24);
+        }
+        cache_size++;
+        low = (low & 0x00FFFFFF) << 8;
+    }
+};
+
+
+/**
+ * @brief Template class for byte-oriented Range Decoding, the inverse of RangeEncoder.
+ *
+ * @tparam T The model type providing frequency and symbol information.
+ */
+template <typename T>
+class RangeDecoder {
+    using SymbolType = typename T::SymbolType;
+    using FrequencyType = typename T::FrequencyType;
+
+public:
+    size_t bits_read = 0;
+    size_t symbols_read = 0;
+    T model;
+
+
+    RangeDecoder() : bits_read(0), symbols_read(0), code(0), range(0xFFFFFFFF) {}
+
+
+    SymbolType decode(IBitStream &bit_stream) {
+        symbols_read++;
+        return decode_step(bit_stream, code, range, bits_read);
+    }
+
+    /**
+     * @brief Decodes up to `n` symbols, each followed by model.update_state.
+     *
+     * The same as calling decode and update_state per symbol, but with the coder state in
+     * locals for the whole span. The stop symbol check is compiled out for models without one.
+     *
+     * @param bit_stream The coded input.
+     * @param out Receives the decoded symbols, without the stop symbol.
+     * @param n The maximum number of symbols to decode.
+     * @return The number of symbols written to `out`, fewer than `n` only after a stop symbol.
+     */
+    size_t decode_n(IBitStream &bit_stream, SymbolType *out, size_t n) {
+        uint32_t c = code, r = range;
+        size_t bits = bits_read;
+        size_t i = 0;
+        size_t stops = 0;
+        for (; i < n; ++i) {
+            const SymbolType symbol = decode_step(bit_stream, c, r, bits);
+            model.update_state(symbol);
+            if (T::HAS_STOP && symbol == T::STOP_SYMBOL) {
+                stops = 1;
+                break;
+            }
+            out[i] = symbol;
+        }
+        code = c;
+        range = r;
+        bits_read = bits;
+        symbols_read += i + stops;
+        return i;
+    }
+
+    /**
+     * @brief Prepares for a new code word, keeping the model state. Call init() next.
+     */
+    void restart() {
+        code = 0;
+        range = 0xFFFFFFFF;
+    }
+
+    void init(IBitStream &bit_stream) {
+        // the first byte is the encoder's initial (empty) cache byte
+        code = 0;
+        for (int i=0; i<5; ++i) {
+            code = (code << 8) | bit_stream.get_bits(8);
+        }
+        bits_read += 40;
+    }
+
+    /**
+     * @brief Saves the coder and model state, see checkpoint.hpp.
+     */
+    void save(CheckpointWriter &writer) const {
+        writer.put(bits_read, 8);
+        writer.put(symbols_read, 8);
+        writer.put(code, 4);
+        writer.put(range, 4);
+        model.save(writer);
+    }
+
+    /**
+     * @brief Restores the coder and model state, the bit stream continues after the bits_read
+     *        bits that were read before the checkpoint.
+     */
+    void restore(CheckpointReader &reader) {
+        bits_read = reader.get(8);
+        symbols_read = reader.get(8);
+        code = static_cast<uint32_t>(reader.get(4));
+        range = static_cast<uint32_t>(reader.get(4));
+        if (range < RANGE_TOP || code >= range) {
+            throw std::runtime_error("Invalid coder checkpoint");
+        }
+        model.restore(reader);
+    }
+
+private:
+    uint32_t code, range;
+
+    // decodes one symbol from the coder state in code and range
+    SymbolType decode_step(IBitStream &bit_stream, uint32_t &code, uint32_t &range, size_t &bits_read) {
+        FrequencyType symbol_low, symbol_high;
+
+        // Lookup the symbol based in the frequency
+        uint32_t r = range / T::MAX_FREQUENCY;
+        uint32_t scaled_value = code / r;
+        if (scaled_value >= T::MAX_FREQUENCY) {
+            scaled_value = T::MAX_FREQUENCY - 1;
+        }
+
+        SymbolType symbol = model.frequency_symbol(static_cast<FrequencyType>(scaled_value));
+
+        // get the [low, high) cumulative frequency range of a symbol
+        model.symbol_low_high(symbol, symbol_low, symbol_high);
+
+        // rescale code and range
+        code -= r * symbol_low;
+        range = r * (symbol_high - symbol_low);
+
+        while (range < RANGE_TOP) {
+            code = (code << 8) | bit_stream.get_bits(8);
+            range <<= 8;
+            bits_read += 8;
+        }
+
+        return symbol;
+    }
+};
+
+#endif
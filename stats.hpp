@@ -0,0 +1,304 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+
+// Default number of samples per point of the bits/sample timeline
+static constexpr size_t STATS_WINDOW = 1 << 20;
+
+// Number of power-of-two buckets of the pending run length histogram: 1, 2-3, 4-7, ...
+static constexpr int PENDING_BUCKETS = 8;
+
+// Number of 1 ns buckets of the latency histogram, longer latencies share the last bucket
+static constexpr size_t LATENCY_BUCKETS = 1 << 14;
+
+
+/**
+ * @brief Coding statistics of a single stream or channel, collected sample by sample.
+ *
+ * Filled by the command-line tools with --stats. The counters are read from the public state
+ * of the coder and its model after every sample, the coders themselves are not changed.
+ */
+struct CodingStats {
+    size_t window = STATS_WINDOW;
+
+    size_t samples = 0;
+    size_t outliers = 0;                   ///< samples for which the outlier filter skipped the update
+    std::vector<size_t> distributions;     ///< histogram of the selected conditional distribution
+    std::vector<size_t> pending_runs = std::vector<size_t>(PENDING_BUCKETS, 0);
+    std::vector<double> timeline;          ///< bits/sample of every complete window
+
+    size_t bits = 0;
+    size_t window_start_bits = 0;
+    size_t last_pending = 0;
+
+    /**
+     * @brief Records the state after an encoded sample.
+     */
+    template <typename Encoder>
+    void record_encoded(const Encoder &coder) {
+        // a run of pending bits ends when the coder writes bits again
+        if (coder.bits_written != bits && last_pending > 0) {
+            add_pending_run(last_pending);
+        }
+        last_pending = coder.pending();
+        record(coder.model, coder.bits_written);
+    }
+
+    /**
+     * @brief Records the state after a decoded sample.
+     */
+    template <typename Decoder>
+    void record_decoded(const Decoder &coder) {
+        record(coder.model, coder.bits_read);
+    }
+
+    /**
+     * @brief Mean bits per sample over the whole stream.
+     */
+    double bits_per_sample() const {
+        return samples > 0 ? static_cast<double>(bits) / samples : 0.0;
+    }
+
+private:
+    template <typename M>
+    void record(const M &model, size_t total_bits) {
+        if (distributions.empty()) {
+            distributions.assign(M::NUM_DIST, 0);
+        }
+        bits = total_bits;
+        samples++;
+        outliers += model.outlier();
+        distributions[model.distribution()]++;
+
+        if (samples % window == 0) {
+            timeline.push_back(static_cast<double>(bits - window_start_bits) / window);
+            window_start_bits = bits;
+        }
+    }
+
+    void add_pending_run(size_t length) {
+        int bucket = 0;
+        while (bucket < PENDING_BUCKETS - 1 && (length >> (bucket + 1)) != 0) {
+            bucket++;
+        }
+        pending_runs[bucket]++;
+    }
+};
+
+
+/**
+ * @brief Wall-clock time of the phases of an encode or decode run.
+ */
+class PhaseTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    PhaseTimer() : start(Clock::now()), last(start) {}
+
+    /**
+     * @brief Ends the current phase and starts the next one.
+     */
+    void end_phase(const std::string &name) {
+        const Clock::time_point now = Clock::now();
+        phases.emplace_back(name, std::chrono::duration<double>(now - last).count());
+        last = now;
+    }
+
+    double seconds(const std::string &name) const {
+        for (const auto &phase : phases) {
+            if (phase.first == name) {
+                return phase.second;
+            }
+        }
+        return 0.0;
+    }
+
+    void print(std::ostream &out) const {
+        out << "phases:";
+        for (const auto &phase : phases) {
+            out << " " << phase.first << " " << std::fixed << std::setprecision(3) << phase.second * 1e3 << " ms";
+        }
+        out << ", total " << std::chrono::duration<double>(last - start).count() * 1e3 << " ms" << std::endl;
+    }
+
+private:
+    Clock::time_point start;
+    Clock::time_point last;
+    std::vector<std::pair<std::string, double>> phases;
+};
+
+
+/**
+ * @brief Low overhead timestamp for timing single calls, the time stamp counter where available.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+inline uint64_t read_ticks() {
+    return __rdtsc();
+}
+#else
+inline uint64_t read_ticks() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+#endif
+
+
+/**
+ * @brief Nanoseconds per tick of read_ticks(), measured once against the steady clock.
+ */
+inline double nanoseconds_per_tick() {
+    static const double ns = [] {
+        using Clock = std::chrono::steady_clock;
+        const Clock::time_point start = Clock::now();
+        const uint64_t t0 = read_ticks();
+        while (Clock::now() - start < std::chrono::milliseconds(50)) {
+        }
+        const Clock::time_point end = Clock::now();
+        const uint64_t t1 = read_ticks();
+        return std::chrono::duration<double>(end - start).count() * 1e9 / static_cast<double>(t1 - t0);
+    }();
+    return ns;
+}
+
+
+/**
+ * @brief The smallest time between two consecutive read_ticks() calls, subtracted from latencies.
+ */
+inline uint64_t tick_overhead() {
+    static const uint64_t overhead = [] {
+        uint64_t best = UINT64_MAX;
+        for (int i = 0; i < 10000; ++i) {
+            const uint64_t t0 = read_ticks();
+            const uint64_t t1 = read_ticks();
+            best = std::min(best, t1 - t0);
+        }
+        return best;
+    }();
+    return overhead;
+}
+
+
+/**
+ * @brief Histogram of single call latencies in 1 ns buckets.
+ *
+ * Unlike a list of all latencies its size does not grow with the recording, and the histograms
+ * of several recordings merge into the percentiles of all of them.
+ */
+struct LatencyHistogram {
+    std::vector<uint64_t> counts;
+    uint64_t total = 0;
+
+    LatencyHistogram() : counts(LATENCY_BUCKETS, 0) {}
+
+    void add_ticks(uint64_t ticks) {
+        const uint64_t overhead = tick_overhead();
+        const double ns = static_cast<double>(ticks > overhead ? ticks - overhead : 0) * nanoseconds_per_tick();
+        counts[std::min(static_cast<size_t>(ns), LATENCY_BUCKETS - 1)]++;
+        total++;
+    }
+
+    void merge(const LatencyHistogram &other) {
+        for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+    }
+
+    /**
+     * @brief The latency in ns that a fraction p of the calls do not exceed, 0 when empty.
+     */
+    double percentile(double p) const {
+        const uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(total > 0 ? total - 1 : 0));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen > rank) {
+                return static_cast<double>(i);
+            }
+        }
+        return 0.0;
+    }
+};
+
+
+/**
+ * @brief Prints the statistics of the streams or channels of a run.
+ *
+ * @param out The stream to print to, the command-line tools use std::cerr.
+ * @param stats The statistics of every channel.
+ * @param timer The phase timings, the throughput is measured over the "coding" phase.
+ * @param encoded True for the encoder, which also tracks pending runs.
+ */
+inline void print_stats(std::ostream &out, const std::vector<CodingStats> &stats, const PhaseTimer &timer, bool encoded) {
+    size_t samples = 0, bits = 0, outliers = 0;
+    for (const CodingStats &s : stats) {
+        samples += s.samples;
+        bits += s.bits;
+        outliers += s.outliers;
+    }
+    const double coding = timer.seconds("coding");
+
+    out << std::fixed << std::setprecision(3);
+    out << "samples: " << samples << ", bits/sample: " << (samples ? static_cast<double>(bits) / samples : 0.0)
+        << ", outliers: " << outliers << std::endl;
+    if (coding > 0) {
+        out << "throughput: " << samples / coding / 1e6 << " Msamples/s, "
+            << samples * 2 / coding / 1e6 << " MB/s of 16-bit samples" << std::endl;
+    }
+    timer.print(out);
+
+    for (size_t c = 0; c < stats.size(); ++c) {
+        const CodingStats &s = stats[c];
+        out << (stats.size() > 1 ? "channel " + std::to_string(c) + ": " : std::string())
+            << "bits/sample " << s.bits_per_sample() << ", outliers " << s.outliers << ", distributions";
+        for (size_t d = 0; d < s.distributions.size(); ++d) {
+            out << " " << (s.samples ? 100.0 * s.distributions[d] / s.samples : 0.0) << "%";
+        }
+        out << std::endl;
+
+        if (encoded) {
+            out << "  pending runs (1, 2-3, 4-7, ...):";
+            for (size_t count : s.pending_runs) {
+                out << " " << count;
+            }
+            out << std::endl;
+        }
+        if (!s.timeline.empty()) {
+            out << "  bits/sample per " << s.window << " samples:";
+            for (double b : s.timeline) {
+                out << " " << b;
+            }
+            out << std::endl;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,380 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef STREAMING_HPP
+#define STREAMING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include "bitstream.hpp"
+#include "neuralink.hpp"
+#include "arithmetic_coding.hpp"
+#include "range_coding.hpp"
+#include "brainwire.hpp"
+#include "checkpoint.hpp"
+
+/*
+ * Streaming API for embedding the codec in an application
+ *
+ * StreamEncoder turns pushed 16-bit samples into bytes and StreamDecoder turns pushed bytes back
+ * into samples. Both work on caller-owned buffers and allocate only at construction. The bytes
+ * are the payload of a stream: the same bytes encode writes after the stream header, without
+ * the WAV and brainwire headers. Use write_brainwire_header and read_brainwire_header around
+ * them to produce or read .brainwire files.
+ *
+ * Both can save a checkpoint of their state between pushes, from which a new encoder or
+ * decoder of the same types continues the stream bit-exactly, for example on a standby node.
+ * A checkpoint is the magic "NMCK", the checkpoint version, the coder and the model kind as in
+ * the stream header, the symbol bits, the number of distributions (2 bytes), the stop symbol
+ * flag, the frequency total of the model (4 bytes) and the finished flags, followed by the
+ * state of the coder, the model and the bit stream, see checkpoint.hpp. A checkpoint is only
+ * restored into an encoder or decoder that matches all of the prefix. An encoder checkpoint
+ * is a few dozen bytes plus the bytes that were not handed out yet; with the adaptive model
+ * it also holds the adapted table rows.
+ */
+
+// Default size of the internal byte buffer of StreamEncoder
+static constexpr size_t STREAM_BUFFER_SIZE = 1 << 12;
+
+
+/**
+ * @brief The stream header id of a coder engine, for the checkpoint prefix.
+ */
+template <template <typename> class Coder>
+struct CheckpointCoder;
+
+template <>
+struct CheckpointCoder<ArithmeticEncoder> {
+    static constexpr BrainwireCoder ID = BrainwireCoder::Arithmetic;
+};
+
+template <>
+struct CheckpointCoder<ArithmeticDecoder> {
+    static constexpr BrainwireCoder ID = BrainwireCoder::Arithmetic;
+};
+
+template <>
+struct CheckpointCoder<RangeEncoder> {
+    static constexpr BrainwireCoder ID = BrainwireCoder::Range;
+};
+
+template <>
+struct CheckpointCoder<RangeDecoder> {
+    static constexpr BrainwireCoder ID = BrainwireCoder::Range;
+};
+
+
+/**
+ * @brief The stream header id of a model kind, for the checkpoint prefix.
+ */
+template <typename M>
+struct CheckpointModel;
+
+template <uint32_t TOTAL_FREQUENCY, typename LAYOUT>
+struct CheckpointModel<BasicModel<TOTAL_FREQUENCY, LAYOUT>> {
+    static constexpr BrainwireModel ID = BrainwireModel::FloatingPoint;
+};
+
+template <uint32_t TOTAL_FREQUENCY, typename LAYOUT>
+struct CheckpointModel<BasicFixedPointModel<TOTAL_FREQUENCY, LAYOUT>> {
+    static constexpr BrainwireModel ID = BrainwireModel::FixedPoint;
+};
+
+template <uint32_t TOTAL_FREQUENCY, typename LAYOUT>
+struct CheckpointModel<BasicAdaptiveModel<TOTAL_FREQUENCY, LAYOUT>> {
+    static constexpr BrainwireModel ID = BrainwireModel::Adaptive;
+};
+
+
+/**
+ * @brief Writes the magic, the version, the coder and the model description of a checkpoint.
+ */
+template <template <typename> class Coder, typename M>
+void put_checkpoint_prefix(CheckpointWriter &writer) {
+    writer.put_bytes(reinterpret_cast<const uint8_t*>(CHECKPOINT_MAGIC), 4);
+    writer.put(CHECKPOINT_VERSION, 1);
+    writer.put(static_cast<uint8_t>(CheckpointCoder<Coder>::ID), 1);
+    writer.put(static_cast<uint8_t>(CheckpointModel<M>::ID), 1);
+    writer.put(M::SYMBOL_BITS, 1);
+    writer.put(M::NUM_DIST, 2);
+    writer.put(M::HAS_STOP ? 1 : 0, 1);
+    writer.put(M::MAX_FREQUENCY, 4);
+}
+
+
+/**
+ * @brief Checks the prefix written by put_checkpoint_prefix.
+ *
+ * @throws std::runtime_error if it is not a checkpoint of this version, coder and model.
+ */
+template <template <typename> class Coder, typename M>
+void get_checkpoint_prefix(CheckpointReader &reader) {
+    uint8_t magic[4];
+    reader.get_bytes(magic, 4);
+    if (std::memcmp(magic, CHECKPOINT_MAGIC, 4) != 0 || reader.get(1) != CHECKPOINT_VERSION) {
+        throw std::runtime_error("Unsupported checkpoint");
+    }
+    if (reader.get(1) != static_cast<uint8_t>(CheckpointCoder<Coder>::ID)) {
+        throw std::runtime_error("Checkpoint of another coder");
+    }
+    const uint64_t model = reader.get(1);
+    const uint64_t symbol_bits = reader.get(1);
+    const uint64_t distributions = reader.get(2);
+    const uint64_t stop = reader.get(1);
+    if (model != static_cast<uint8_t>(CheckpointModel<M>::ID) || symbol_bits != M::SYMBOL_BITS ||
+        distributions != M::NUM_DIST || stop != (M::HAS_STOP ? 1u : 0u) || reader.get(4) != M::MAX_FREQUENCY) {
+        throw std::runtime_error("Checkpoint of another model");
+    }
+}
+
+
+/**
+ * @brief Encodes pushed samples into caller-owned byte buffers.
+ *
+ * @tparam Coder The coder engine, ArithmeticEncoder or RangeEncoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Coder = ArithmeticEncoder, typename M = Model>
+class StreamEncoder {
+    static_assert(M::HAS_STOP, "The stream ends with a stop symbol");
+
+public:
+    /**
+     * @param bufferSize The size of the internal buffer for bytes that did not fit in the
+     *        caller's buffer yet. It only grows if more bytes than this are waiting.
+     */
+    explicit StreamEncoder(size_t bufferSize = STREAM_BUFFER_SIZE) : bitstream(bufferSize) {}
+
+    /**
+     * @brief Encodes samples and returns the completed bytes.
+     *
+     * The coder only releases bytes once they are fully determined, so a push can return fewer
+     * bytes than the samples cost and a later push more.
+     *
+     * @param samples The signed 16-bit samples.
+     * @param count The number of samples.
+     * @param out Receives the completed bytes.
+     * @param capacity The size of `out`, bytes that do not fit are returned by the next call.
+     * @return The number of bytes written to `out`.
+     */
+    size_t push(const int16_t *samples, size_t count, uint8_t *out, size_t capacity) {
+        for (size_t i = 0; i < count; ++i) {
+            const typename M::SymbolType symbol = neuralink_16bit_to_symbol<M::SYMBOL_BITS>(samples[i]);
+            coder.encode(symbol, bitstream);
+            coder.model.update_state(symbol);
+        }
+        return bitstream.take(out, capacity);
+    }
+
+    /**
+     * @brief Terminates the stream with the stop symbol and returns the remaining bytes.
+     *
+     * Call repeatedly until it returns 0 if `capacity` can be too small for the remaining bytes.
+     * No samples can be pushed afterwards.
+     *
+     * @return The number of bytes written to `out`.
+     */
+    size_t finish(uint8_t *out, size_t capacity) {
+        if (!finished) {
+            coder.encode(M::STOP_SYMBOL, bitstream);
+            coder.flush(bitstream);
+            bitstream.flush();
+            finished = true;
+        }
+        return bitstream.take(out, capacity);
+    }
+
+    /**
+     * @brief The number of completed bytes waiting for a caller buffer.
+     */
+    size_t pending() const {
+        return bitstream.size();
+    }
+
+    /**
+     * @brief Saves the encoder state after the last push.
+     *
+     * An encoder restored from the checkpoint returns the bytes this encoder would return next,
+     * including the pending() bytes.
+     */
+    std::vector<uint8_t> checkpoint() {
+        CheckpointWriter writer;
+        put_checkpoint_prefix<Coder, M>(writer);
+        writer.put(finished ? 1 : 0, 1);
+        coder.save(writer);
+        bitstream.save(writer);
+        return writer.bytes();
+    }
+
+    /**
+     * @brief Continues the stream of the encoder that saved the checkpoint.
+     *
+     * @throws std::runtime_error if the checkpoint is invalid or of other coder or model types.
+     */
+    void restore(const uint8_t *data, size_t size) {
+        CheckpointReader reader(data, size);
+        get_checkpoint_prefix<Coder, M>(reader);
+        finished = reader.get(1) != 0;
+        coder.restore(reader);
+        bitstream.restore(reader);
+        if (reader.remaining() != 0) {
+            throw std::runtime_error("Invalid checkpoint");
+        }
+    }
+
+private:
+    Coder<M> coder;
+    OBitStream bitstream;
+    bool finished = false;
+};
+
+
+/**
+ * @brief Decodes pushed bytes into caller-owned sample buffers.
+ *
+ * A symbol is only decoded when enough input has arrived to decode it exactly, at most the
+ * last 8 bytes are held back until more bytes are pushed or finish() is called.
+ *
+ * @tparam Coder The coder engine, ArithmeticDecoder or RangeDecoder.
+ * @tparam M The model type.
+ */
+template <template <typename> class Coder = ArithmeticDecoder, typename M = Model>
+class StreamDecoder {
+    static_assert(M::HAS_STOP, "The stream ends with a stop symbol");
+
+public:
+    // input bits needed to decode one symbol, or to start the coder, with any coder engine
+    static constexpr size_t LOOKAHEAD_BITS = 64;
+
+    StreamDecoder() : bitstream(nullptr, 0) {}
+
+    /**
+     * @brief Decodes the samples that the pushed bytes complete.
+     *
+     * @param bytes The next bytes of the stream.
+     * @param size The number of bytes.
+     * @param samples Receives the decoded samples.
+     * @param capacity The size of `samples`. When it is full, consumed() can be less than
+     *        `size` and the unconsumed bytes must be pushed again.
+     * @return The number of samples written.
+     */
+    size_t push(const uint8_t *bytes, size_t size, int16_t *samples, size_t capacity) {
+        bitstream.feed(bytes, size);
+        const size_t count = decode(samples, capacity, LOOKAHEAD_BITS);
+        if (!finished() && bitstream.available_bits() < LOOKAHEAD_BITS) {
+            // keep the few remaining bits, the caller can release its buffer
+            bitstream.absorb();
+            lastConsumed = size;
+        } else {
+            // the output is full or the stream ended, bytes already in the bit accumulator
+            // count as consumed
+            lastConsumed = size - bitstream.unread_bytes();
+            bitstream.feed(nullptr, 0);
+        }
+        return count;
+    }
+
+    /**
+     * @brief Decodes the remaining samples after the last byte of the stream was pushed.
+     *
+     * Call repeatedly until finished() if `capacity` can be too small.
+     *
+     * @return The number of samples written.
+     */
+    size_t finish(int16_t *samples, size_t capacity) {
+        return decode(samples, capacity, 0);
+    }
+
+    /**
+     * @brief The number of bytes of the last push that were used.
+     */
+    size_t consumed() const {
+        return lastConsumed;
+    }
+
+    /**
+     * @brief Returns true once the stop symbol was decoded.
+     */
+    bool finished() const {
+        return stopped;
+    }
+
+    /**
+     * @brief Saves the decoder state after the last push.
+     *
+     * A decoder restored from the checkpoint continues with the bytes after the consumed() bytes
+     * of the last push.
+     */
+    std::vector<uint8_t> checkpoint() const {
+        CheckpointWriter writer;
+        put_checkpoint_prefix<Coder, M>(writer);
+        writer.put((started ? 1 : 0) | (stopped ? 2 : 0), 1);
+        coder.save(writer);
+        bitstream.save(writer);
+        return writer.bytes();
+    }
+
+    /**
+     * @brief Continues the stream of the decoder that saved the checkpoint.
+     *
+     * @throws std::runtime_error if the checkpoint is invalid or of other coder or model types.
+     */
+    void restore(const uint8_t *data, size_t size) {
+        CheckpointReader reader(data, size);
+        get_checkpoint_prefix<Coder, M>(reader);
+        const uint64_t flags = reader.get(1);
+        started = (flags & 1) != 0;
+        stopped = (flags & 2) != 0;
+        coder.restore(reader);
+        bitstream.restore(reader);
+        if (reader.remaining() != 0) {
+            throw std::runtime_error("Invalid checkpoint");
+        }
+        lastConsumed = 0;
+    }
+
+private:
+    Coder<M> coder;
+    IBitStream bitstream;
+    size_t lastConsumed = 0;
+    bool started = false;
+    bool stopped = false;
+
+    size_t decode(int16_t *samples, size_t capacity, size_t lookahead) {
+        if (!started) {
+            if (bitstream.available_bits() < lookahead) {
+                return 0;
+            }
+            coder.init(bitstream);
+            started = true;
+        }
+        size_t count = 0;
+        while (!stopped && count < capacity && bitstream.available_bits() >= lookahead) {
+            const typename M::SymbolType symbol = coder.decode(bitstream);
+            coder.model.update_state(symbol);
+            if (symbol == M::STOP_SYMBOL) {
+                stopped = true;
+            } else {
+                samples[count++] = neuralink_symbol_to_16bit<M::SYMBOL_BITS>(symbol);
+            }
+        }
+        return count;
+    }
+};
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "wav.hpp"
+#include "neuralink.hpp"
+#include "brainwire.hpp"
+#include "streaming.hpp"
+
+/*
+ * Round trip test of the streaming API against the encode tool.
+ *
+ * Usage: streamtest [--seed=N] [path/to/encode]
+ *
+ * Synthetic recordings are encoded by the encode tool with every coder engine and model, and
+ * by StreamEncoder, and decoded by StreamDecoder. The samples and the bytes are pushed in
+ * random amounts into output buffers of random capacities, and after every push and finish
+ * the encoder and decoder are replaced by new ones restored from their checkpoint. The bytes
+ * of StreamEncoder must equal the payload that encode writes after the headers, and
+ * StreamDecoder must return the samples of the recording.
+ */
+
+
+// most samples or bytes per push, and largest output capacity
+static constexpr size_t MAX_PUSH = 3000;
+static constexpr size_t MAX_CAPACITY = 1500;
+
+// pushes and finishes without any progress after which a run fails instead of looping
+static constexpr size_t MAX_IDLE_CALLS = 1000;
+
+
+struct TestSettings {
+    uint32_t seed = 1;                      ///< seed of the push sizes, capacities and samples
+    std::string encoder = "./encode";       ///< path of the encode tool
+    std::string workDir;                    ///< directory of the recordings and encoded files
+};
+
+
+/**
+ * @brief A 44-byte header of a mono 16-bit recording at the Neuralink sample rate.
+ */
+std::vector<uint8_t> monoWavHeader(size_t samples) {
+    std::vector<uint8_t> header(44, 0);
+    const auto put = [&header](size_t pos, uint32_t value, int size) {
+        for (int i = 0; i < size; ++i) {
+            header[pos + i] = static_cast<uint8_t>(value >> (8 * i));
+        }
+    };
+    const uint32_t rate = 19531;
+    std::copy_n("RIFF", 4, header.begin());
+    std::copy_n("WAVEfmt ", 8, header.begin() + 8);
+    put(16, 16, 4);         // fmt chunk size
+    put(20, 1, 2);          // PCM
+    put(22, 1, 2);          // channels
+    put(24, rate, 4);
+    put(28, rate * 2, 4);   // bytes per second
+    put(32, 2, 2);          // bytes per sample frame
+    put(34, 16, 2);         // bits per sample
+    std::copy_n("data", 4, header.begin() + 36);
+    set_wav_data_size(header, static_cast<uint32_t>(2 * samples));
+    return header;
+}
+
+
+// AR(1) noise around the mid level with occasional spikes, as 16-bit samples
+std::vector<int16_t> syntheticSamples(size_t count, std::mt19937 &rng) {
+    std::normal_distribution<double> noise(0.0, 12.0);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<int16_t> samples(count);
+    double x = 0;
+    for (size_t i = 0; i < count; ++i) {
+        x = 0.6 * x + noise(rng);
+        double y = x + (uniform(rng) < 0.001 ? 200.0 : 0.0);
+        samples[i] = neuralink_10bit_to_16bit(static_cast<SymbolType>(std::min(1023.0, std::max(0.0, std::round(511 + y)))));
+    }
+    return samples;
+}
+
+
+/**
+ * @brief Encodes a recording with the encode tool and returns the payload after the headers.
+ */
+std::vector<uint8_t> encodePayload(const TestSettings &settings, const std::vector<int16_t> &samples, const std::string &options) {
+    const std::string wavPath = settings.workDir + "/input.wav";
+    const std::string codedPath = settings.workDir + "/input.brainwire";
+    {
+        std::ofstream output(wavPath, std::ios::binary);
+        write_wav_header(output, monoWavHeader(samples.size()));
+        output.write(reinterpret_cast<const char*>(samples.data()), samples.size() * sizeof(int16_t));
+        if (!output) {
+            throw std::runtime_error("Error writing " + wavPath);
+        }
+    }
+
+    const std::string command = "'" + settings.encoder + "' " + options + " '" + wavPath + "' '" + codedPath + "'";
+    if (std::system(command.c_str()) != 0) {
+        throw std::runtime_error("Failed: " + command);
+    }
+
+    std::ifstream input(codedPath, std::ios::binary);
+    read_brainwire_header(input);
+    std::vector<uint8_t> payload((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+    std::remove(wavPath.c_str());
+    std::remove(codedPath.c_str());
+    return payload;
+}
+
+
+/**
+ * @brief Encodes with random push sizes and capacities, restoring a checkpoint after every call.
+ */
+template <template <typename> class Coder, typename M>
+std::vector<uint8_t> streamEncode(const std::vector<int16_t> &samples, std::mt19937 &rng) {
+    std::uniform_int_distribution<size_t> pushSize(0, MAX_PUSH);
+    std::uniform_int_distribution<size_t> capacity(0, MAX_CAPACITY);
+    std::vector<uint8_t> buffer(MAX_CAPACITY);
+    std::vector<uint8_t> bytes;
+
+    std::unique_ptr<StreamEncoder<Coder, M>> encoder(new StreamEncoder<Coder, M>());
+    const auto restart = [&encoder]() {
+        const std::vector<uint8_t> checkpoint = encoder->checkpoint();
+        encoder.reset(new StreamEncoder<Coder, M>());
+        encoder->restore(checkpoint.data(), checkpoint.size());
+    };
+
+    for (size_t begin = 0; begin < samples.size(); ) {
+        const size_t count = std::min(pushSize(rng), samples.size() - begin);
+        const size_t n = encoder->push(samples.data() + begin, count, buffer.data(), capacity(rng));
+        bytes.insert(bytes.end(), buffer.begin(), buffer.begin() + n);
+        begin += count;
+        restart();
+    }
+
+    // finish returns 0 once all bytes are out, so its capacities are at least one byte
+    size_t n;
+    do {
+        n = encoder->finish(buffer.data(), 1 + capacity(rng));
+        bytes.insert(bytes.end(), buffer.begin(), buffer.begin() + n);
+        restart();
+    } while (n > 0);
+    return bytes;
+}
+
+
+/**
+ * @brief Decodes with random push sizes and capacities, restoring a checkpoint after every call.
+ */
+template <template <typename> class Coder, typename M>
+std::vector<int16_t> streamDecode(const std::vector<uint8_t> &bytes, std::mt19937 &rng) {
+    std::uniform_int_distribution<size_t> pushSize(0, MAX_PUSH);
+    std::uniform_int_distribution<size_t> capacity(0, MAX_CAPACITY);
+    std::vector<int16_t> buffer(MAX_CAPACITY);
+    std::vector<int16_t> samples;
+
+    std::unique_ptr<StreamDecoder<Coder, M>> decoder(new StreamDecoder<Coder, M>());
+    size_t pos = 0;
+    size_t idle = 0;
+    while (!decoder->finished()) {
+        size_t n;
+        size_t consumed = 0;
+        if (pos < bytes.size()) {
+            const size_t size = std::min(pushSize(rng), bytes.size() - pos);
+            n = decoder->push(bytes.data() + pos, size, buffer.data(), capacity(rng));
+            consumed = decoder->consumed();
+            pos += consumed;
+        } else {
+            n = decoder->finish(buffer.data(), capacity(rng));
+        }
+        samples.insert(samples.end(), buffer.begin(), buffer.begin() + n);
+
+        idle = n == 0 && consumed == 0 ? idle + 1 : 0;
+        if (idle > MAX_IDLE_CALLS) {
+            throw std::runtime_error("The decoder makes no progress");
+        }
+
+        const std::vector<uint8_t> checkpoint = decoder->checkpoint();
+        decoder.reset(new StreamDecoder<Coder, M>());
+        decoder->restore(checkpoint.data(), checkpoint.size());
+    }
+    return samples;
+}
+
+
+/**
+ * @brief Tests one coder engine and model on recordings of several lengths.
+ *
+ * @return The number of failed recordings.
+ */
+template <template <typename> class Encoder, template <typename> class Decoder, typename M>
+size_t testStreams(const TestSettings &settings, const std::string &name, const std::string &options, std::mt19937 &rng) {
+    size_t failures = 0;
+    for (size_t count : {0, 1, 2, 1000, 100000}) {
+        const std::vector<int16_t> samples = syntheticSamples(count, rng);
+        const std::vector<uint8_t> payload = encodePayload(settings, samples, options);
+
+        std::string error;
+        const std::vector<uint8_t> bytes = streamEncode<Encoder, M>(samples, rng);
+        if (bytes != payload) {
+            error = "the stream differs from the payload of encode";
+        } else if (streamDecode<Decoder, M>(bytes, rng) != samples) {
+            error = "the decoded samples differ";
+        }
+        std::cout << name << ", " << count << " samples: " << (error.empty() ? "ok" : "FAILED: " + error) << std::endl;
+        failures += error.empty() ? 0 : 1;
+    }
+    return failures;
+}
+
+
+void printUsage(const char *program) {
+    std::cerr << "Usage: " << program << " [--seed=N] [path/to/encode]" << std::endl;
+}
+
+
+// the command-line tool, main reports the errors it throws
+int run(int argc, char* argv[]) {
+    TestSettings settings;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.compare(0, 7, "--seed=") == 0) {
+            settings.seed = static_cast<uint32_t>(std::strtoul(arg.c_str() + 7, nullptr, 10));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            settings.encoder = arg;
+        }
+    }
+
+    const char *tmp = std::getenv("TMPDIR");
+    std::string workTemplate = std::string(tmp && *tmp ? tmp : "/tmp") + "/neuromasterblaster-streamtest-XXXXXX";
+    std::vector<char> workBuffer(workTemplate.begin(), workTemplate.end());
+    workBuffer.push_back('\0');
+    if (mkdtemp(workBuffer.data()) == nullptr) {
+        throw std::runtime_error("Error creating a work directory in " + workTemplate);
+    }
+    settings.workDir = workBuffer.data();
+
+    std::mt19937 rng(settings.seed);
+    size_t failures = 0;
+    try {
+        failures += testStreams<ArithmeticEncoder, ArithmeticDecoder, Model>(settings, "arithmetic, float", "", rng);
+        failures += testStreams<ArithmeticEncoder, ArithmeticDecoder, FixedPointModel>(settings, "arithmetic, fixed", "--model=fixed", rng);
+        failures += testStreams<ArithmeticEncoder, ArithmeticDecoder, AdaptiveModel>(settings, "arithmetic, adaptive", "--model=adaptive", rng);
+        failures += testStreams<RangeEncoder, RangeDecoder, Model>(settings, "range, float", "--coder=range", rng);
+        failures += testStreams<RangeEncoder, RangeDecoder, FixedPointModel>(settings, "range, fixed", "--coder=range --model=fixed", rng);
+        failures += testStreams<RangeEncoder, RangeDecoder, AdaptiveModel>(settings, "range, adaptive", "--coder=range --model=adaptive", rng);
+    } catch (...) {
+        rmdir(settings.workDir.c_str());
+        throw;
+    }
+    rmdir(settings.workDir.c_str());
+
+    if (failures > 0) {
+        std::cout << failures << " failed, seed " << settings.seed << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "all streams ok" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[]) {
+    try {
+        return run(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
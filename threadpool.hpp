@@ -0,0 +1,164 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+/**
+ * @brief Returns the default number of worker threads, the number of hardware threads.
+ */
+inline size_t default_thread_count() {
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+
+/**
+ * @brief A fixed set of worker threads that run parallel loops over independent work items.
+ *
+ * Idle workers claim the next unprocessed item from a shared atomic counter, so threads that
+ * finish early keep taking work from the others until the loop is done. The calling thread
+ * takes part in every loop, a pool of size 1 runs everything on the calling thread.
+ */
+class ThreadPool {
+public:
+    /**
+     * @brief Starts the worker threads.
+     *
+     * @param threads The total number of threads running a loop, including the calling thread.
+     */
+    explicit ThreadPool(size_t threads = default_thread_count())
+        : job_count(0), next_index(0), generation(0), busy_workers(0), stopping(false) {
+        for (size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(&ThreadPool::worker_loop, this);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        start_cv.notify_all();
+        for (auto &worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const {
+        return workers.size() + 1;
+    }
+
+    /**
+     * @brief Calls `f(i)` for every i in [0, count) and waits until all calls have returned.
+     *
+     * @param count The number of work items.
+     * @param f The work function, called concurrently for different items.
+     * @throws The first exception thrown by `f`, after all threads finished the loop.
+     */
+    void parallel_for(size_t count, const std::function<void(size_t)> &f) {
+        if (workers.empty() || count <= 1) {
+            for (size_t i = 0; i < count; ++i) {
+                f(i);
+            }
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &f;
+            job_count = count;
+            next_index = 0;
+            error = nullptr;
+            busy_workers = workers.size();
+            generation++;
+        }
+        start_cv.notify_all();
+
+        run_items();
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done_cv.wait(lock, [this] { return busy_workers == 0; });
+        job = nullptr;
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+
+    const std::function<void(size_t)> *job = nullptr;
+    size_t job_count;
+    std::atomic<size_t> next_index;
+    size_t generation;
+    size_t busy_workers;
+    bool stopping;
+    std::exception_ptr error;
+
+    void run_items() {
+        size_t i;
+        while ((i = next_index.fetch_add(1)) < job_count) {
+            try {
+                (*job)(i);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+
+    void worker_loop() {
+        size_t seen_generation = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                start_cv.wait(lock, [&] { return stopping || generation != seen_generation; });
+                if (stopping) {
+                    return;
+                }
+                seen_generation = generation;
+            }
+
+            run_items();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy_workers--;
+            }
+            done_cv.notify_one();
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,245 @@
+/*
+ * Copyright 2024 Thijs van den Berg, thijs@sitmo.com
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "wav.hpp"
+#include "neuralink.hpp"
+#include "threadpool.hpp"
+
+/*
+ * Fits the ModelParameters to a recording.
+ *
+ * Usage: tune [options] input.wav parameters.txt
+ *
+ * The cost of a set of parameters is the entropy estimate of the recording under the model:
+ * the sum of -log2(p) of every symbol, with p read from the ccft of the selected distribution.
+ * This is within a few bytes of the arithmetic coded size, but needs no coder and no output.
+ * A parallel compass search minimizes it: every round evaluates a relative step up and down
+ * of every constant concurrently, moves to the best improvement, and halves the steps when
+ * there is none. The result is written with write_model_parameters, for encode --parameters.
+ */
+
+
+using Clock = std::chrono::steady_clock;
+
+// number of samples used per channel by default, a prefix of the recording
+static constexpr size_t DEFAULT_SAMPLES = 1 << 18;
+
+// initial and final relative step of the search
+static constexpr double INITIAL_STEP = 0.2;
+static constexpr double MIN_STEP = 0.002;
+
+// default maximum number of search rounds
+static constexpr int DEFAULT_ROUNDS = 200;
+
+
+struct TuneSettings {
+    size_t threads = 1;                 ///< number of concurrent evaluations
+    size_t samples = DEFAULT_SAMPLES;   ///< samples per channel used by the fit
+    long channel = -1;                  ///< channel to fit, -1 for all channels
+    int rounds = DEFAULT_ROUNDS;        ///< maximum number of search rounds
+};
+
+
+/**
+ * @brief Reads the first `samples` symbols of every channel, or of one channel.
+ */
+std::vector<std::vector<SymbolType>> readChannels(const std::string &path, const TuneSettings &settings) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Error opening input file: " + path);
+    }
+    const size_t channels = neuralink_check_wav_header(read_wav_header(input));
+    if (settings.channel >= static_cast<long>(channels)) {
+        throw std::runtime_error("No such channel");
+    }
+
+    std::vector<std::vector<SymbolType>> symbols(channels);
+    std::vector<int16_t> samples(channels << 12);
+    std::vector<SymbolType> chunk(samples.size());
+    size_t frame = 0;
+    size_t count;
+    while (frame < settings.samples && (count = neuralink_read_samples_from_stream(input, samples.data(), samples.size())) > 0) {
+        neuralink_16bit_to_10bit(samples.data(), chunk.data(), count);
+        for (size_t i = 0; i < count && frame < settings.samples; ++frame) {
+            for (size_t c = 0; c < channels && i < count; ++c, ++i) {
+                symbols[c].push_back(chunk[i]);
+            }
+        }
+    }
+
+    if (settings.channel >= 0) {
+        return std::vector<std::vector<SymbolType>>(1, symbols[settings.channel]);
+    }
+    return symbols;
+}
+
+
+/**
+ * @brief The entropy estimate, in bits, of the channels under a model with these parameters.
+ */
+double estimateBits(const ModelParameters &params, const std::vector<std::vector<SymbolType>> &channels) {
+    std::unique_ptr<Model::Tables> tables(new Model::Tables(Model::make_tables(params)));
+
+    double bits = 0;
+    for (const std::vector<SymbolType> &symbols : channels) {
+        bits += model_entropy_bits(Model(params, *tables), symbols.data(), symbols.size());
+    }
+    return bits;
+}
+
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options] input.wav parameters.txt" << std::endl;
+    std::cerr << "Options:" << std::endl;
+    std::cerr << "  --samples=N  samples per channel used by the fit (default: 2^18)" << std::endl;
+    std::cerr << "  --channel=C  fit the parameters to channel C only (default: all channels)" << std::endl;
+    std::cerr << "  --rounds=N   maximum number of search rounds (default: 200)" << std::endl;
+    std::cerr << "  --threads=N  concurrent evaluations (default: number of hardware threads)" << std::endl;
+    std::cerr << "Encode with the fitted parameters using encode --parameters=parameters.txt" << std::endl;
+}
+
+
+// the command-line tool, main reports the errors it throws
+int run(int argc, char* argv[]) {
+
+    TuneSettings settings;
+    settings.threads = default_thread_count();
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg.compare(0, 10, "--samples=") == 0) {
+            settings.samples = std::max(1LL, std::atoll(arg.c_str() + 10));
+        } else if (arg.compare(0, 10, "--channel=") == 0) {
+            settings.channel = std::atol(arg.c_str() + 10);
+        } else if (arg.compare(0, 9, "--rounds=") == 0) {
+            settings.rounds = std::atoi(arg.c_str() + 9);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            settings.threads = std::max(1, std::atoi(arg.c_str() + 10));
+        } else if (arg.compare(0, 2, "--") == 0) {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        } else {
+            paths.push_back(arg);
+        }
+    }
+    if (paths.size() != 2) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    const Clock::time_point start = Clock::now();
+    const std::vector<std::vector<SymbolType>> channels = readChannels(paths[0], settings);
+    size_t total_samples = 0;
+    for (const std::vector<SymbolType> &symbols : channels) {
+        total_samples += symbols.size();
+    }
+    if (total_samples == 0) {
+        throw std::runtime_error("Empty recording");
+    }
+
+    ThreadPool pool(settings.threads);
+
+    ModelParameters best;
+    std::vector<double> x = best.values();
+    const double initial_bits = estimateBits(best, channels);
+    double best_bits = initial_bits;
+    std::vector<double> steps(x.size(), INITIAL_STEP);
+    size_t evaluations = 1;
+
+    // candidate 2i multiplies constant i by (1 + step), candidate 2i + 1 by (1 - step)
+    std::vector<ModelParameters> candidates(2 * x.size());
+    std::vector<uint8_t> valid(candidates.size());
+    std::vector<double> bits(candidates.size());
+
+    for (int round = 0; round < settings.rounds; ++round) {
+        if (*std::max_element(steps.begin(), steps.end()) < MIN_STEP) {
+            break;
+        }
+
+        for (size_t k = 0; k < candidates.size(); ++k) {
+            std::vector<double> y = x;
+            const size_t i = k / 2;
+            y[i] *= (k % 2 == 0) ? 1 + steps[i] : 1 - steps[i];
+            candidates[k] = best;
+            valid[k] = 0;
+            try {
+                candidates[k].set_values(y);
+                valid[k] = steps[i] >= MIN_STEP;
+            } catch (const std::runtime_error &) {
+            }
+        }
+
+        pool.parallel_for(candidates.size(), [&](size_t k) {
+            bits[k] = valid[k] ? estimateBits(candidates[k], channels) : HUGE_VAL;
+        });
+
+        size_t improved = candidates.size();
+        for (size_t k = 0; k < candidates.size(); ++k) {
+            evaluations += valid[k];
+            if (bits[k] < best_bits) {
+                best_bits = bits[k];
+                improved = k;
+            }
+        }
+
+        if (improved == candidates.size()) {
+            for (double &step : steps) {
+                step *= 0.5;
+            }
+        } else {
+            best = candidates[improved];
+            x = best.values();
+        }
+    }
+
+    std::ofstream outputFile(paths[1]);
+    if (!outputFile) {
+        std::cerr << "Error opening output file: " << paths[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    outputFile << "# fitted by tune to " << paths[0] << "\n";
+    write_model_parameters(outputFile, best);
+
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::cout << std::fixed << std::setprecision(4)
+              << "bits/sample: " << initial_bits / total_samples << " -> " << best_bits / total_samples
+              << " (" << std::setprecision(2) << 100.0 * (1.0 - best_bits / initial_bits) << "% smaller), "
+              << evaluations << " evaluations of " << total_samples << " samples in "
+              << seconds << " s" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char* argv[]) {
+    try {
+        return run(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
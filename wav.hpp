@@ -29,7 +29,7 @@
  * @param inStream The input stream from which to read the WAV header.
  * @return A vector containing the 44-byte WAV header.
  */
-std::vector<uint8_t> read_wav_header(std::istream& inputStream) {
+inline std::vector<uint8_t> read_wav_header(std::istream& inputStream) {
     std::vector<uint8_t> header;
 
     // Read the header
@@ -49,7 +49,7 @@ std::vector<uint8_t> read_wav_header(std::istream& inputStream) {
  * @param header The vector containing the 44-byte WAV header.
  * @throws std::runtime_error If the header size is not 44 bytes.
  */
-std::ostream &write_wav_header(std::ostream& outputStream, const std::vector<uint8_t>& header) {
+inline std::ostream &write_wav_header(std::ostream& outputStream, const std::vector<uint8_t>& header) {
     // Verify that the header size is correct
     if (header.size() != 44) {
         throw std::runtime_error("Invalid WAV header size");
@@ -59,4 +59,32 @@ std::ostream &write_wav_header(std::ostream& outputStream, const std::vector<uin
     return outputStream.write(reinterpret_cast<const char*>(header.data()), header.size());
 }
 
+/**
+ * @brief Sets the size of the sample data in a 44-byte WAV header.
+ *
+ * Updates the data chunk size and the RIFF chunk size that depends on it, for example when
+ * only part of a recording is written.
+ *
+ * @param header The vector containing the 44-byte WAV header.
+ * @param dataSize The size of the sample data in bytes.
+ */
+inline void set_wav_data_size(std::vector<uint8_t>& header, uint32_t dataSize) {
+    const uint32_t riffSize = dataSize + 36;
+    for (int i = 0; i < 4; ++i) {
+        header[4 + i] = static_cast<uint8_t>(riffSize >> (8 * i));
+        header[40 + i] = static_cast<uint8_t>(dataSize >> (8 * i));
+    }
+}
+
+/**
+ * @brief Returns the size of the sample data in bytes from a 44-byte WAV header.
+ */
+inline uint32_t get_wav_data_size(const std::vector<uint8_t>& header) {
+    uint32_t dataSize = 0;
+    for (int i = 0; i < 4; ++i) {
+        dataSize |= static_cast<uint32_t>(header[40 + i]) << (8 * i);
+    }
+    return dataSize;
+}
+
 #endif
\ No newline at end of file